@@ -11,6 +11,14 @@ macro (ttest name)
   set_property(TEST ${name} PROPERTY FIXTURES_REQUIRED compile)
 endmacro (ttest)
 
+# A reassembler test, run once with each storage mode (unless it chooses its own)
+macro (ttest_reassembler name)
+  ttest(${name})
+  add_test(NAME ${name}_bitmap COMMAND "${name}_sanitized")
+  set_property(TEST ${name}_bitmap PROPERTY FIXTURES_REQUIRED compile)
+  set_property(TEST ${name}_bitmap PROPERTY ENVIRONMENT REASSEMBLER_STORAGE=bitmap)
+endmacro (ttest_reassembler)
+
 set_property(TEST ${compile_name} PROPERTY TIMEOUT -1)
 set_tests_properties(${compile_name} PROPERTIES FIXTURES_SETUP compile)
 
@@ -23,14 +31,17 @@ ttest(byte_stream_one_write)
 ttest(byte_stream_two_writes)
 ttest(byte_stream_many_writes)
 ttest(byte_stream_stress_test)
-
-ttest(reassembler_single)
-ttest(reassembler_cap)
-ttest(reassembler_seq)
-ttest(reassembler_dup)
-ttest(reassembler_holes)
-ttest(reassembler_overlapping)
+ttest(byte_stream_writev)
+ttest(byte_stream_concurrent)
+
+ttest_reassembler(reassembler_single)
+ttest_reassembler(reassembler_cap)
+ttest_reassembler(reassembler_seq)
+ttest_reassembler(reassembler_dup)
+ttest_reassembler(reassembler_holes)
+ttest_reassembler(reassembler_overlapping)
 ttest(reassembler_win)
+ttest_reassembler(reassembler_budget)
 
 ttest(wrapping_integers_cmp)
 ttest(wrapping_integers_wrap)
@@ -54,9 +65,20 @@ ttest(send_ack)
 ttest(send_close)
 ttest(send_extra)
 
+ttest(checksum)
+ttest(buffer_headroom)
+ttest(buffer_pool)
+ttest(parser)
+
 ttest(net_interface)
 
 ttest(router)
+ttest(forwarding_table)
+ttest(rcu)
+ttest(route_cache)
+ttest(arp_table)
+ttest(timer_wheel)
+ttest(router_parallel)
 
 add_custom_target (check0 COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --stop-on-failure --timeout 12 -R 'webget|^byte_stream_')
 
@@ -68,9 +90,9 @@ add_custom_target (check2 COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --s
 
 add_custom_target (check3 COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --stop-on-failure --timeout 12 -R '^byte_stream_|^reassembler_|^wrapping|^recv|^send')
 
-add_custom_target (check4 COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --stop-on-failure --timeout 12 -R '^net_interface')
+add_custom_target (check4 COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --stop-on-failure --timeout 12 -R '^buffer_headroom|^buffer_pool|^parser|^net_interface|^arp_table|^timer_wheel')
 
-add_custom_target (check5 COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --stop-on-failure --timeout 12 -R '^net_interface|^router')
+add_custom_target (check5 COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --stop-on-failure --timeout 12 -R '^buffer_headroom|^buffer_pool|^parser|^net_interface|^arp_table|^timer_wheel|^router|^forwarding_table|^rcu|^route_cache|^router_parallel')
 
 ###
 
@@ -89,4 +111,9 @@ set_property(TEST ${compile_name_opt} PROPERTY TIMEOUT -1)
 set_tests_properties(${compile_name_opt} PROPERTIES FIXTURES_SETUP compile_opt)
 
 stest(byte_stream_speed_test)
+stest(byte_stream_concurrent_speed_test)
 stest(reassembler_speed_test)
+stest(reassembler_pattern_speed_test)
+stest(router_speed_test)
+stest(router_parallel_speed_test)
+stest(framing_speed_test)
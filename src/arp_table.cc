@@ -0,0 +1,71 @@
+#include "arp_table.hh"
+
+#include <utility>
+
+using namespace std;
+
+size_t ArpTable::slot_of( const uint32_t address ) const
+{
+  size_t i = home_of( address );
+  while ( slots_[i].occupied and slots_[i].entry.address != address ) {
+    i = ( i + 1 ) & mask();
+  }
+  return i;
+}
+
+ArpEntry* ArpTable::find( const uint32_t address )
+{
+  Slot& slot = slots_[slot_of( address )];
+  return slot.occupied ? &slot.entry : nullptr;
+}
+
+ArpEntry& ArpTable::find_or_insert( const uint32_t address )
+{
+  size_t i = slot_of( address );
+  if ( slots_[i].occupied ) {
+    return slots_[i].entry;
+  }
+
+  if ( ( size_ + 1 ) * 2 > slots_.size() ) {
+    grow();
+    i = slot_of( address );
+  }
+
+  slots_[i].occupied = true;
+  slots_[i].entry.address = address;
+  ++size_;
+  return slots_[i].entry;
+}
+
+void ArpTable::erase( const uint32_t address )
+{
+  size_t hole = slot_of( address );
+  if ( not slots_[hole].occupied ) {
+    return;
+  }
+
+  // Move back each later entry of the run that would still be reachable from its home slot
+  for ( size_t i = ( hole + 1 ) & mask(); slots_[i].occupied; i = ( i + 1 ) & mask() ) {
+    const size_t distance_from_home = ( i - home_of( slots_[i].entry.address ) ) & mask();
+    if ( distance_from_home >= ( ( i - hole ) & mask() ) ) {
+      slots_[hole].entry = std::move( slots_[i].entry );
+      hole = i;
+    }
+  }
+
+  slots_[hole] = {};
+  --size_;
+}
+
+void ArpTable::grow()
+{
+  vector<Slot> old_slots = std::move( slots_ );
+  ++bits_;
+  slots_ = vector<Slot>( size_t { 1 } << bits_ );
+
+  for ( auto& slot : old_slots ) {
+    if ( slot.occupied ) {
+      slots_[slot_of( slot.entry.address )] = std::move( slot );
+    }
+  }
+}
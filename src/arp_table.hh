@@ -0,0 +1,83 @@
+#pragma once
+
+#include "ethernet_header.hh"
+#include "ipv4_datagram.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A datagram waiting for the Ethernet address of its next hop
+struct PendingDatagram
+{
+  InternetDatagram datagram {};
+  size_t queued_at {}; // The time (in ms) it started waiting
+};
+
+// What a NetworkInterface knows about one IP address on its network
+struct ArpEntry
+{
+  uint32_t address {};                      // The IP address (numeric, as by Address::ipv4_numeric())
+  bool has_mapping {};                      // Whether `ethernet_address` has been learned (it may have expired)
+  bool request_sent {};                     // Whether an ARP request for `address` has been sent
+  EthernetAddress ethernet_address {};      // The Ethernet address that `address` maps to
+  size_t mapping_expires_at {};             // The time (in ms) after which the mapping is no longer used
+  size_t request_sent_at {};                // The time (in ms) the latest ARP request was sent
+  bool timer_set {};                        // Whether a timer is set for this entry
+  size_t timer_deadline {};                 // The time (in ms) that timer is set for
+  std::vector<PendingDatagram> pending {};  // Datagrams waiting for the mapping, oldest first
+  size_t pending_bytes {};                  // The total size of `pending`
+};
+
+// A hash table of ArpEntry keyed by IP address, with the entries stored inline in a single array
+// (open addressing with linear probing). Entries are removed by shifting later entries of the same
+// probe sequence back, so no tombstones build up. Finding an entry never allocates, and neither does
+// inserting one, except to grow the table when it becomes half full.
+//
+// Inserting may move every entry, so a pointer or reference to an entry is only good until the
+// next call to find_or_insert() or erase().
+class ArpTable
+{
+  static constexpr unsigned MIN_BITS = 4;
+
+  struct Slot
+  {
+    bool occupied {};
+    ArpEntry entry {};
+  };
+
+  std::vector<Slot> slots_ = std::vector<Slot>( size_t { 1 } << MIN_BITS );
+  unsigned bits_ { MIN_BITS };
+  size_t size_ {};
+
+  size_t mask() const { return slots_.size() - 1; }
+  size_t home_of( uint32_t address ) const { return ( address * 0x9e3779b1U ) >> ( 32 - bits_ ); }
+
+  // The index of the slot holding `address`, or of the empty slot where it would go
+  size_t slot_of( uint32_t address ) const;
+
+  void grow();
+
+public:
+  // The entry for `address`, or nullptr if there is none
+  ArpEntry* find( uint32_t address );
+
+  // The entry for `address`, inserting an empty one if there is none
+  ArpEntry& find_or_insert( uint32_t address );
+
+  // Remove the entry for `address`, if any
+  void erase( uint32_t address );
+
+  size_t size() const { return size_; }
+
+  // Call `f( entry )` for each entry, in no particular order
+  template<typename F>
+  void for_each( F&& f )
+  {
+    for ( auto& slot : slots_ ) {
+      if ( slot.occupied ) {
+        f( slot.entry );
+      }
+    }
+  }
+};
@@ -1,50 +1,129 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
 #include <stdexcept>
 
 #include "byte_stream.hh"
 
 using namespace std;
 
-ByteStream::ByteStream( uint64_t capacity )
-  : capacity_( capacity ), pushed_( 0 ), popped_( 0 ), has_error_( false ), is_closed_( false ), data_()
+ByteStream::ByteStream( uint64_t capacity, Storage storage )
+  : capacity_( capacity )
+  , pushed_( 0 )
+  , popped_( 0 )
+  , has_error_( false )
+  , is_closed_( false )
+  , data_( std::in_place_type<ChunkQueue> )
+{
+  if ( storage == Storage::Ring ) {
+    data_.emplace<RingBuffer>( capacity );
+  }
+}
+
+ByteStream::RingBuffer::RingBuffer( uint64_t capacity )
+  : data_( std::bit_ceil( std::max( capacity, uint64_t { 1 } ) ) ), mask_( data_.size() - 1 )
 {}
 
-uint64_t ByteStream::StringQueue::size() const
+void ByteStream::RingBuffer::push( std::string_view data )
 {
-  return data_.size() - popped_;
+  const uint64_t offset = tail_ & mask_;
+  const uint64_t first_part = std::min( data.size(), data_.size() - offset );
+  std::memcpy( data_.data() + offset, data.data(), first_part );
+  std::memcpy( data_.data(), data.data() + first_part, data.size() - first_part );
+  tail_ += data.size();
+}
+
+uint64_t ByteStream::RingBuffer::pop( uint64_t len )
+{
+  const uint64_t bytes_to_pop = std::min( len, size() );
+  head_ += bytes_to_pop;
+
+  // Rewind an empty ring so that the next pushes are contiguous.
+  if ( head_ == tail_ ) {
+    head_ = tail_ = 0;
+  }
+
+  return bytes_to_pop;
 }
 
-void ByteStream::StringQueue::push( char c )
+std::array<std::string_view, 2> ByteStream::RingBuffer::peek() const
 {
-  data_.push_back( c );
+  const uint64_t offset = head_ & mask_;
+  const uint64_t first_part = std::min( size(), data_.size() - offset );
+  return { std::string_view { data_.data() + offset, first_part },
+           std::string_view { data_.data(), size() - first_part } };
 }
 
-uint64_t ByteStream::StringQueue::pop( uint64_t len )
+void ByteStream::RingBuffer::peek_all( std::vector<std::string_view>& out ) const
 {
-  const uint64_t bytes_to_pop = std::min( len, data_.size() - popped_ );
-  popped_ += bytes_to_pop;
+  for ( const auto view : peek() ) {
+    if ( !view.empty() ) {
+      out.push_back( view );
+    }
+  }
+}
 
-  if ( popped_ >= data_.size() / 2 ) {
-    data_ = data_.substr( popped_ );
-    popped_ = 0;
+void ByteStream::ChunkQueue::push( std::string data )
+{
+  if ( data.empty() ) {
+    return;
+  }
+  size_ += data.size();
+  chunks_.push_back( std::move( data ) );
+}
+
+uint64_t ByteStream::ChunkQueue::pop( uint64_t len )
+{
+  const uint64_t bytes_to_pop = std::min( len, size_ );
+  size_ -= bytes_to_pop;
+
+  len = bytes_to_pop;
+  while ( len > 0 ) {
+    const uint64_t from_front = std::min( len, chunks_.front().size() - skip_ );
+    skip_ += from_front;
+    len -= from_front;
+    if ( skip_ == chunks_.front().size() ) {
+      chunks_.pop_front();
+      skip_ = 0;
+    }
   }
 
   return bytes_to_pop;
 }
 
-std::string_view ByteStream::StringQueue::peek() const
+std::array<std::string_view, 2> ByteStream::ChunkQueue::peek() const
 {
-  return std::string_view { data_ }.substr( popped_ );
+  std::array<std::string_view, 2> views {};
+  if ( !chunks_.empty() ) {
+    views[0] = std::string_view { chunks_.front() }.substr( skip_ );
+  }
+  if ( chunks_.size() > 1 ) {
+    views[1] = chunks_[1];
+  }
+  return views;
+}
+
+void ByteStream::ChunkQueue::peek_all( std::vector<std::string_view>& out ) const
+{
+  if ( chunks_.empty() ) {
+    return;
+  }
+  out.emplace_back( std::string_view { chunks_.front() }.substr( skip_ ) );
+  for ( auto it = std::next( chunks_.begin() ); it != chunks_.end(); ++it ) {
+    out.emplace_back( *it );
+  }
 }
 
 void Writer::push( string data )
 {
-  for ( auto c : data ) {
-    if ( data_.size() >= capacity_ ) {
-      break;
-    }
-    data_.push( c );
-    ++pushed_;
+  const uint64_t len = std::min( data.size(), available_capacity() );
+  if ( auto* ring = get_if<RingBuffer>( &data_ ) ) {
+    ring->push( string_view { data }.substr( 0, len ) );
+  } else {
+    data.resize( len );
+    get<ChunkQueue>( data_ ).push( std::move( data ) );
   }
+  pushed_ += len;
 }
 
 void Writer::close()
@@ -64,7 +143,7 @@ bool Writer::is_closed() const
 
 uint64_t Writer::available_capacity() const
 {
-  return capacity_ - data_.size();
+  return capacity_ - ( pushed_ - popped_ );
 }
 
 uint64_t Writer::bytes_pushed() const
@@ -74,12 +153,24 @@ uint64_t Writer::bytes_pushed() const
 
 string_view Reader::peek() const
 {
-  return data_.peek();
+  return peek_halves()[0];
+}
+
+array<string_view, 2> Reader::peek_halves() const
+{
+  return visit( []( const auto& queue ) { return queue.peek(); }, data_ );
+}
+
+vector<string_view> Reader::peek_all() const
+{
+  vector<string_view> views;
+  visit( [&views]( const auto& queue ) { queue.peek_all( views ); }, data_ );
+  return views;
 }
 
 bool Reader::is_finished() const
 {
-  return is_closed_ && data_.size() == 0;
+  return is_closed_ && pushed_ == popped_;
 }
 
 bool Reader::has_error() const
@@ -89,12 +180,12 @@ bool Reader::has_error() const
 
 void Reader::pop( uint64_t len )
 {
-  popped_ += data_.pop( len );
+  popped_ += visit( [len]( auto& queue ) { return queue.pop( len ); }, data_ );
 }
 
 uint64_t Reader::bytes_buffered() const
 {
-  return data_.size();
+  return pushed_ - popped_;
 }
 
 uint64_t Reader::bytes_popped() const
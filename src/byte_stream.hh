@@ -1,37 +1,79 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <deque>
 #include <queue>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <variant>
+#include <vector>
 
 class Reader;
 class Writer;
+class FileDescriptor;
 
 class ByteStream
 {
+public:
+  // How a ByteStream stores the bytes that were pushed but not yet popped.
+  //  - Ring: a ring buffer allocated once at construction. Every push copies its bytes in.
+  //  - Chunks: the pushed strings themselves, taken over without copying. Best when writers push
+  //    large, freshly built strings; peek() then returns whatever remains of the oldest one.
+  enum class Storage
+  {
+    Ring,
+    Chunks
+  };
+
 protected:
   uint64_t capacity_;
   uint64_t pushed_;
   uint64_t popped_;
   bool has_error_;
   bool is_closed_;
-  class StringQueue
+  // A fixed-size ring of bytes pushed but not yet popped. The ring is allocated once, with its size
+  // rounded up to a power of two so that positions can be wrapped with a mask. The buffered bytes
+  // occupy at most two contiguous regions: the tail of the ring and the beginning of it.
+  class RingBuffer
   {
-    std::string data_ {};
-    uint64_t popped_ { 0 };
+    std::vector<char> data_;
+    uint64_t mask_;
+    uint64_t head_ { 0 }; // Position of the first buffered byte (unwrapped).
+    uint64_t tail_ { 0 }; // Position one past the last buffered byte (unwrapped).
 
   public:
-    StringQueue() = default;
-    uint64_t size() const; // Size of the queue.
-    void push( char c );   // Push a single byte to the queue.
+    explicit RingBuffer( uint64_t capacity );
+    uint64_t size() const { return tail_ - head_; } // Number of buffered bytes.
+    void push( std::string_view data ); // Append `data`, which must fit in the ring, with at most two copies.
     uint64_t pop(
       uint64_t len ); // Pop specified number of bytes, and return the number of bytes that are popped successfully.
-    std::string_view peek() const; // Return a string_view of the queue.
-  } data_;
+    std::array<std::string_view, 2> peek() const; // Return both contiguous regions of the buffered bytes.
+    void peek_all( std::vector<std::string_view>& out ) const; // Append the non-empty regions to `out`.
+  };
+
+  // A queue of the pushed strings, taken over by move. The first `skip_` bytes of the front chunk
+  // have already been popped.
+  class ChunkQueue
+  {
+    std::deque<std::string> chunks_ {};
+    uint64_t skip_ { 0 };
+    uint64_t size_ { 0 };
+
+  public:
+    uint64_t size() const { return size_; } // Number of buffered bytes.
+    void push( std::string data );          // Append `data` as a new chunk (unless it is empty).
+    uint64_t pop(
+      uint64_t len ); // Pop specified number of bytes, and return the number of bytes that are popped successfully.
+    std::array<std::string_view, 2> peek() const; // Return the remainders of the first two chunks.
+    void peek_all( std::vector<std::string_view>& out ) const; // Append every chunk's remainder to `out`.
+  };
+
+  std::variant<RingBuffer, ChunkQueue> data_;
 
 public:
-  explicit ByteStream( uint64_t capacity );
+  explicit ByteStream( uint64_t capacity, Storage storage = Storage::Ring );
 
   // Helper functions (provided) to access the ByteStream's Reader and Writer interfaces
   Reader& reader();
@@ -57,7 +99,11 @@ class Reader : public ByteStream
 {
 public:
   std::string_view peek() const; // Peek at the next bytes in the buffer
-  void pop( uint64_t len );      // Remove `len` bytes from the buffer
+  // Peek at the buffered bytes in two pieces: all of them with Storage::Ring, the first two chunks
+  // with Storage::Chunks
+  std::array<std::string_view, 2> peek_halves() const;
+  std::vector<std::string_view> peek_all() const; // Peek at every buffered byte, as a list of non-empty pieces
+  void pop( uint64_t len ); // Remove `len` bytes from the buffer (which may span several peeked pieces)
 
   bool is_finished() const; // Is the stream finished (closed and fully popped)?
   bool has_error() const;   // Has the stream had an error?
@@ -71,3 +117,9 @@ public:
  * from a ByteStream Reader into a string;
  */
 void read( Reader& reader, uint64_t len, std::string& out );
+
+/*
+ * write: A helper function that drains as many buffered bytes as possible from a ByteStream
+ * Reader into a file descriptor with a single writev(2), and returns how many were written.
+ */
+uint64_t write( Reader& reader, FileDescriptor& fd );
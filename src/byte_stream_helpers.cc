@@ -1,5 +1,8 @@
 #include "byte_stream.hh"
+#include "file_descriptor.hh"
 
+#include <algorithm>
+#include <climits>
 #include <cstdint>
 #include <stdexcept>
 
@@ -10,18 +13,36 @@
 void read( Reader& reader, uint64_t len, std::string& out )
 {
   out.clear();
+  out.reserve( std::min( len, reader.bytes_buffered() ) );
 
-  while ( reader.bytes_buffered() and out.size() < len ) {
-    auto view = reader.peek();
-
-    if ( view.empty() ) {
-      throw std::runtime_error( "Reader::peek() returned empty string_view" );
+  for ( auto view : reader.peek_all() ) {
+    if ( out.size() >= len ) {
+      break;
     }
-
     view = view.substr( 0, len - out.size() ); // Don't return more bytes than desired.
     out += view;
-    reader.pop( view.size() );
   }
+  reader.pop( out.size() );
+}
+
+/*
+ * write: A helper function that drains as many buffered bytes as possible from a ByteStream
+ * Reader into a file descriptor with a single writev(2), and returns how many were written.
+ */
+uint64_t write( Reader& reader, FileDescriptor& fd )
+{
+  if ( reader.bytes_buffered() == 0 ) {
+    return 0;
+  }
+
+  auto views = reader.peek_all();
+  if ( views.size() > IOV_MAX ) {
+    views.resize( IOV_MAX );
+  }
+
+  const uint64_t bytes_written = fd.write( views );
+  reader.pop( bytes_written );
+  return bytes_written;
 }
 
 Reader& ByteStream::reader()
@@ -0,0 +1,182 @@
+#include "concurrent_byte_stream.hh"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+using namespace std;
+
+ConcurrentByteStream::ConcurrentByteStream( uint64_t capacity )
+  : capacity_( capacity ), data_( bit_ceil( max( capacity, uint64_t { 1 } ) ) ), mask_( data_.size() - 1 )
+{}
+
+void ConcurrentByteStream::signal_reader()
+{
+  writer_signal_.fetch_add( 1, memory_order_release );
+  writer_signal_.notify_one();
+}
+
+void ConcurrentByteStream::signal_writer()
+{
+  reader_signal_.fetch_add( 1, memory_order_release );
+  reader_signal_.notify_one();
+}
+
+void ConcurrentWriter::push( string data )
+{
+  const uint64_t tail = pushed_.load( memory_order_relaxed );
+  const uint64_t head = popped_.load( memory_order_acquire );
+  const uint64_t len = min( static_cast<uint64_t>( data.size() ), capacity_ - ( tail - head ) );
+  if ( len == 0 ) {
+    return;
+  }
+
+  const uint64_t offset = tail & mask_;
+  const uint64_t first_part = min( len, data_.size() - offset );
+  memcpy( data_.data() + offset, data.data(), first_part );
+  memcpy( data_.data(), data.data() + first_part, len - first_part );
+
+  pushed_.store( tail + len, memory_order_release );
+  signal_reader();
+}
+
+void ConcurrentWriter::close()
+{
+  is_closed_.store( true, memory_order_release );
+  signal_reader();
+}
+
+void ConcurrentWriter::set_error()
+{
+  has_error_.store( true, memory_order_release );
+  signal_reader();
+  signal_writer();
+}
+
+bool ConcurrentWriter::is_closed() const
+{
+  return is_closed_.load( memory_order_acquire );
+}
+
+uint64_t ConcurrentWriter::available_capacity() const
+{
+  return capacity_ - ( pushed_.load( memory_order_relaxed ) - popped_.load( memory_order_acquire ) );
+}
+
+uint64_t ConcurrentWriter::bytes_pushed() const
+{
+  return pushed_.load( memory_order_relaxed );
+}
+
+void ConcurrentWriter::wait_writable() const
+{
+  while ( true ) {
+    const uint32_t signal = reader_signal_.load( memory_order_acquire );
+    if ( available_capacity() > 0 || has_error_.load( memory_order_acquire ) ) {
+      return;
+    }
+    reader_signal_.wait( signal, memory_order_acquire );
+  }
+}
+
+array<string_view, 2> ConcurrentReader::peek_halves() const
+{
+  const uint64_t head = popped_.load( memory_order_relaxed );
+  const uint64_t size = pushed_.load( memory_order_acquire ) - head;
+  const uint64_t offset = head & mask_;
+  const uint64_t first_part = min( size, data_.size() - offset );
+  return { string_view { data_.data() + offset, first_part }, string_view { data_.data(), size - first_part } };
+}
+
+string_view ConcurrentReader::peek() const
+{
+  return peek_halves()[0];
+}
+
+vector<string_view> ConcurrentReader::peek_all() const
+{
+  vector<string_view> views;
+  for ( const auto view : peek_halves() ) {
+    if ( !view.empty() ) {
+      views.push_back( view );
+    }
+  }
+  return views;
+}
+
+void ConcurrentReader::pop( uint64_t len )
+{
+  const uint64_t head = popped_.load( memory_order_relaxed );
+  len = min( len, pushed_.load( memory_order_acquire ) - head );
+  if ( len == 0 ) {
+    return;
+  }
+
+  popped_.store( head + len, memory_order_release );
+  signal_writer();
+}
+
+bool ConcurrentReader::is_finished() const
+{
+  // Load `is_closed_` first: the writer closes after its last push, so that push is then visible too.
+  return is_closed_.load( memory_order_acquire )
+         && pushed_.load( memory_order_acquire ) == popped_.load( memory_order_relaxed );
+}
+
+bool ConcurrentReader::has_error() const
+{
+  return has_error_.load( memory_order_acquire );
+}
+
+uint64_t ConcurrentReader::bytes_buffered() const
+{
+  return pushed_.load( memory_order_acquire ) - popped_.load( memory_order_relaxed );
+}
+
+uint64_t ConcurrentReader::bytes_popped() const
+{
+  return popped_.load( memory_order_relaxed );
+}
+
+void ConcurrentReader::wait_readable() const
+{
+  while ( true ) {
+    const uint32_t signal = writer_signal_.load( memory_order_acquire );
+    if ( bytes_buffered() > 0 || is_closed_.load( memory_order_acquire ) || has_error() ) {
+      return;
+    }
+    writer_signal_.wait( signal, memory_order_acquire );
+  }
+}
+
+ConcurrentReader& ConcurrentByteStream::reader()
+{
+  static_assert( sizeof( ConcurrentReader ) == sizeof( ConcurrentByteStream ),
+                 "Please add member variables to the ConcurrentByteStream base, not the ConcurrentReader." );
+
+  return static_cast<ConcurrentReader&>( *this ); // NOLINT(*-downcast)
+}
+
+const ConcurrentReader& ConcurrentByteStream::reader() const
+{
+  static_assert( sizeof( ConcurrentReader ) == sizeof( ConcurrentByteStream ),
+                 "Please add member variables to the ConcurrentByteStream base, not the ConcurrentReader." );
+
+  return static_cast<const ConcurrentReader&>( *this ); // NOLINT(*-downcast)
+}
+
+ConcurrentWriter& ConcurrentByteStream::writer()
+{
+  static_assert( sizeof( ConcurrentWriter ) == sizeof( ConcurrentByteStream ),
+                 "Please add member variables to the ConcurrentByteStream base, not the ConcurrentWriter." );
+
+  return static_cast<ConcurrentWriter&>( *this ); // NOLINT(*-downcast)
+}
+
+const ConcurrentWriter& ConcurrentByteStream::writer() const
+{
+  static_assert( sizeof( ConcurrentWriter ) == sizeof( ConcurrentByteStream ),
+                 "Please add member variables to the ConcurrentByteStream base, not the ConcurrentWriter." );
+
+  return static_cast<const ConcurrentWriter&>( *this ); // NOLINT(*-downcast)
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class ConcurrentReader;
+class ConcurrentWriter;
+
+/*
+ * A ByteStream that may be written by one thread while it is read by another. It offers the same
+ * Writer and Reader interfaces as ByteStream, backed by a single-producer/single-consumer ring:
+ * only the writer advances `pushed_` and only the reader advances `popped_`, and each side publishes
+ * its progress with a release store that the other side picks up with an acquire load.
+ *
+ * Either side may block until the other one makes progress with wait_writable()/wait_readable().
+ *
+ * Unlike ByteStream, a ConcurrentByteStream can be neither copied nor moved.
+ */
+class ConcurrentByteStream
+{
+protected:
+  // Keep the two counters (and the signals that wake up the other side) on separate cache lines,
+  // so that the writer and the reader do not keep stealing a shared line from each other.
+  static constexpr size_t CACHE_LINE_SIZE = 64;
+
+  uint64_t capacity_;
+  std::vector<char> data_;
+  uint64_t mask_;
+
+  alignas( CACHE_LINE_SIZE ) std::atomic<uint64_t> pushed_ { 0 };
+  std::atomic<uint32_t> writer_signal_ { 0 }; // Bumped whenever the writer pushes, closes or sets an error.
+
+  alignas( CACHE_LINE_SIZE ) std::atomic<uint64_t> popped_ { 0 };
+  std::atomic<uint32_t> reader_signal_ { 0 }; // Bumped whenever the reader pops.
+
+  alignas( CACHE_LINE_SIZE ) std::atomic<bool> has_error_ { false };
+  std::atomic<bool> is_closed_ { false };
+
+  void signal_reader();
+  void signal_writer();
+
+public:
+  explicit ConcurrentByteStream( uint64_t capacity );
+
+  ConcurrentByteStream( const ConcurrentByteStream& other ) = delete;
+  ConcurrentByteStream& operator=( const ConcurrentByteStream& other ) = delete;
+  ConcurrentByteStream( ConcurrentByteStream&& other ) = delete;
+  ConcurrentByteStream& operator=( ConcurrentByteStream&& other ) = delete;
+  ~ConcurrentByteStream() = default;
+
+  // Access the ConcurrentByteStream's Reader and Writer interfaces. Each may be used by one thread at a time.
+  ConcurrentReader& reader();
+  const ConcurrentReader& reader() const;
+  ConcurrentWriter& writer();
+  const ConcurrentWriter& writer() const;
+};
+
+class ConcurrentWriter : public ConcurrentByteStream
+{
+public:
+  void push( std::string data ); // Push data to stream, but only as much as available capacity allows.
+
+  void close();     // Signal that the stream has reached its ending. Nothing more will be written.
+  void set_error(); // Signal that the stream suffered an error.
+
+  bool is_closed() const;              // Has the stream been closed?
+  uint64_t available_capacity() const; // How many bytes can be pushed to the stream right now?
+  uint64_t bytes_pushed() const;       // Total number of bytes cumulatively pushed to the stream
+
+  void wait_writable() const; // Block until there is available capacity (or the stream has an error)
+};
+
+class ConcurrentReader : public ConcurrentByteStream
+{
+public:
+  std::string_view peek() const; // Peek at the next bytes in the buffer
+  // Peek at all buffered bytes in two pieces (the second is non-empty when they wrap around the ring)
+  std::array<std::string_view, 2> peek_halves() const;
+  std::vector<std::string_view> peek_all() const; // Peek at every buffered byte, as a list of non-empty pieces
+  void pop( uint64_t len ); // Remove `len` bytes from the buffer (which may span several peeked pieces)
+
+  bool is_finished() const; // Is the stream finished (closed and fully popped)?
+  bool has_error() const;   // Has the stream had an error?
+
+  uint64_t bytes_buffered() const; // Number of bytes currently buffered (pushed and not popped)
+  uint64_t bytes_popped() const;   // Total number of bytes cumulatively popped from stream
+
+  void wait_readable() const; // Block until bytes are buffered, or the stream is closed or has an error
+};
@@ -0,0 +1,103 @@
+#include "forwarding_table.hh"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+
+using namespace std;
+
+namespace {
+atomic<uint64_t> next_generation { 1 }; // NOLINT(*-non-const-global-variables)
+}
+
+ForwardingTable::ForwardingTable() : generation_( next_generation++ ) {}
+
+ForwardingTable::ForwardingTable( const RoutingTable& routing_table ) : ForwardingTable()
+{
+  size_t num_routes = 0;
+  for ( const auto& routes : routing_table ) {
+    num_routes += routes.size();
+  }
+  routes_.reserve( num_routes );
+
+  for ( size_t prefix_length = 0; prefix_length < routing_table.size(); ++prefix_length ) {
+    for ( const auto& [prefix, route] : routing_table[prefix_length] ) {
+      routes_.push_back( route );
+      insert( prefix, prefix_length, routes_.size() );
+    }
+  }
+}
+
+uint32_t ForwardingTable::descend( uint32_t& entry, vector<uint32_t>& level )
+{
+  if ( not( entry & CHUNK_FLAG ) ) {
+    const auto chunk = static_cast<uint32_t>( level.size() / CHUNK_SIZE );
+    level.resize( level.size() + CHUNK_SIZE, entry );
+    entry = chunk | CHUNK_FLAG;
+  }
+  return entry & ~CHUNK_FLAG;
+}
+
+void ForwardingTable::insert( const uint32_t prefix, const uint8_t prefix_length, const uint32_t value )
+{
+  const auto fill = [value]( vector<uint32_t>& level, size_t first, uint8_t bits_left ) {
+    fill_n( level.begin() + static_cast<ptrdiff_t>( first ), size_t { 1 } << bits_left, value );
+  };
+
+  if ( prefix_length <= 16 ) {
+    fill( level16_, prefix >> 16, 16 - prefix_length );
+    return;
+  }
+
+  const size_t index24 = descend( level16_[prefix >> 16], level24_ ) * CHUNK_SIZE + ( ( prefix >> 8 ) & 0xff );
+  if ( prefix_length <= 24 ) {
+    fill( level24_, index24, 24 - prefix_length );
+    return;
+  }
+
+  const size_t index32 = descend( level24_[index24], level32_ ) * CHUNK_SIZE + ( prefix & 0xff );
+  fill( level32_, index32, 32 - prefix_length );
+}
+
+void ForwardingTable::lookup( span<const uint32_t> addresses, span<const Route*> routes ) const
+{
+  constexpr size_t MAX_BATCH = 64;
+  array<uint32_t, MAX_BATCH> entries {};
+
+  for ( size_t first = 0; first < addresses.size(); first += MAX_BATCH ) {
+    const auto batch = addresses.subspan( first, min( MAX_BATCH, addresses.size() - first ) );
+
+    for ( const uint32_t address : batch ) {
+      __builtin_prefetch( &level16_[address >> 16] );
+    }
+
+    for ( size_t i = 0; i < batch.size(); ++i ) {
+      entries[i] = level16_[batch[i] >> 16];
+      if ( entries[i] & CHUNK_FLAG ) {
+        __builtin_prefetch( &level24_[( entries[i] & ~CHUNK_FLAG ) * CHUNK_SIZE + ( ( batch[i] >> 8 ) & 0xff )] );
+      }
+    }
+
+    for ( size_t i = 0; i < batch.size(); ++i ) {
+      if ( entries[i] & CHUNK_FLAG ) {
+        entries[i] = level24_[( entries[i] & ~CHUNK_FLAG ) * CHUNK_SIZE + ( ( batch[i] >> 8 ) & 0xff )];
+        if ( entries[i] & CHUNK_FLAG ) {
+          __builtin_prefetch( &level32_[( entries[i] & ~CHUNK_FLAG ) * CHUNK_SIZE + ( batch[i] & 0xff )] );
+        }
+      }
+    }
+
+    for ( size_t i = 0; i < batch.size(); ++i ) {
+      if ( entries[i] & CHUNK_FLAG ) {
+        entries[i] = level32_[( entries[i] & ~CHUNK_FLAG ) * CHUNK_SIZE + ( batch[i] & 0xff )];
+      }
+      routes[first + i] = entries[i] ? &routes_[entries[i] - 1] : nullptr;
+    }
+  }
+}
+
+size_t ForwardingTable::memory_usage() const
+{
+  return ( level16_.size() + level24_.size() + level32_.size() ) * sizeof( uint32_t )
+         + routes_.size() * sizeof( Route );
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+// A forwarding rule: where to send a datagram whose destination matches the rule's prefix. Kept to
+// two words so that the forwarding path can copy it freely; an Address is only built at the edges.
+struct Route
+{
+  static constexpr uint32_t DIRECT = 0; // The next hop of a network directly attached to the router
+
+  uint32_t next_hop;      // The IPv4 address of the next hop (numeric, host order), or DIRECT
+  uint32_t interface_num; // The index of the interface to send the datagram out on
+
+  // The address to send a datagram for `destination` to
+  uint32_t next_hop_for( const uint32_t destination ) const { return next_hop == DIRECT ? destination : next_hop; }
+};
+static_assert( sizeof( Route ) == 8 );
+
+// The routing table as configured: for each prefix length (0 to 32), a map from the prefix
+// (with every bit past the prefix length cleared) to its Route.
+using RoutingTable = std::array<std::unordered_map<uint32_t, Route>, 33>;
+
+// Mask off every bit of `address` past the first `prefix_length` bits.
+constexpr uint32_t prefix_of( const uint32_t address, const uint8_t prefix_length )
+{
+  return prefix_length == 0 ? 0 : address & ~( ( uint64_t { 1 } << ( 32 - prefix_length ) ) - 1 );
+}
+
+// A longest-prefix-match lookup structure compiled from a RoutingTable, laid out DIR-16-8-8 style:
+// a 65536-entry table indexed by the top 16 bits of the address, whose entries either name the
+// matching route or point to a 256-entry chunk indexed by the next 8 bits, whose entries in turn
+// name a route or point to a chunk indexed by the last 8 bits. A lookup therefore reads one to three
+// entries, and never follows more than two dependent loads.
+//
+// Each route is "expanded" into every entry its prefix covers. Routes are inserted from shortest
+// to longest prefix, so a longer prefix overwrites the shorter ones it overlaps, and a chunk created
+// for a longer prefix starts out filled with the entry it replaced.
+class ForwardingTable
+{
+  static constexpr uint32_t CHUNK_FLAG = 1U << 31; // Set if an entry points to a chunk of the next level
+  static constexpr size_t CHUNK_SIZE = 256;
+
+  uint64_t generation_;
+
+  std::vector<Route> routes_ {}; // An entry that is not a chunk pointer holds a route's index + 1 (or 0 for none)
+  std::vector<uint32_t> level16_ = std::vector<uint32_t>( size_t { 1 } << 16 );
+  std::vector<uint32_t> level24_ {};
+  std::vector<uint32_t> level32_ {};
+
+  // Make `entry` point to a chunk of `level`, creating one filled with the entry's route if necessary
+  static uint32_t descend( uint32_t& entry, std::vector<uint32_t>& level );
+
+  void insert( uint32_t prefix, uint8_t prefix_length, uint32_t value );
+
+public:
+  ForwardingTable();
+  explicit ForwardingTable( const RoutingTable& routing_table );
+
+  // A number that no other ForwardingTable shares, so that a cache of lookups can tell when the
+  // table it was filled from has been replaced
+  uint64_t generation() const { return generation_; }
+
+  // The route with the longest prefix that matches `address`, or nullptr if none does
+  const Route* lookup( const uint32_t address ) const
+  {
+    uint32_t entry = level16_[address >> 16];
+    if ( entry & CHUNK_FLAG ) {
+      entry = level24_[( entry & ~CHUNK_FLAG ) * CHUNK_SIZE + ( ( address >> 8 ) & 0xff )];
+      if ( entry & CHUNK_FLAG ) {
+        entry = level32_[( entry & ~CHUNK_FLAG ) * CHUNK_SIZE + ( address & 0xff )];
+      }
+    }
+    return entry ? &routes_[entry - 1] : nullptr;
+  }
+
+  // Look up a batch of addresses at once, storing the route for `addresses[i]` in `routes[i]`. Each
+  // level of the table is read for the whole batch, after prefetching the entries it needs, so the
+  // cache misses of different lookups overlap instead of following one another. On router_speed_test
+  // this is no faster than one lookup at a time, so Router::route() does not use it.
+  void lookup( std::span<const uint32_t> addresses, std::span<const Route*> routes ) const;
+
+  size_t size() const { return routes_.size(); } // Number of routes
+  size_t memory_usage() const;                    // Bytes used by the lookup tables
+};
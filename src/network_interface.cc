@@ -3,12 +3,29 @@
 #include "arp_message.hh"
 #include "ethernet_frame.hh"
 
+#include <algorithm>
+#include <cstdint>
+
 using namespace std;
 
+namespace {
+
+// The size of a datagram, as it will be sent
+size_t size_of( const InternetDatagram& dgram )
+{
+  size_t size = dgram.header.hlen * 4UL;
+  for ( const auto& buffer : dgram.payload ) {
+    size += buffer.size();
+  }
+  return size;
+}
+
+} // namespace
+
 // ethernet_address: Ethernet (what ARP calls "hardware") address of the interface
 // ip_address: IP (what ARP calls "protocol") address of the interface
 NetworkInterface::NetworkInterface( const EthernetAddress& ethernet_address, const Address& ip_address )
-  : ethernet_address_( ethernet_address ), ip_address_( ip_address )
+  : ethernet_address_( ethernet_address ), ip_address_( ip_address.ipv4_numeric() )
 {
   cerr << "DEBUG: Network interface has Ethernet address " << to_string( ethernet_address_ ) << " and IP address "
        << ip_address.ip() << "\n";
@@ -16,35 +33,97 @@ NetworkInterface::NetworkInterface( const EthernetAddress& ethernet_address, con
 
 // dgram: the IPv4 datagram to be sent
 // next_hop: the IP address of the interface to send it to (typically a router or default gateway, but
-// may also be another host if directly connected to the same network as the destination)
-
-// Note: the Address type can be converted to a uint32_t (raw 32-bit IP address) by using the
-// Address::ipv4_numeric() method.
-void NetworkInterface::send_datagram( const InternetDatagram& dgram, const Address& next_hop )
+// may also be another host if directly connected to the same network as the destination), as a raw
+// 32-bit IP address (see Address::ipv4_numeric())
+NetworkInterface::SendResult NetworkInterface::send_datagram( InternetDatagram&& dgram, const uint32_t next_hop )
 {
-  auto ethernet_address = look_for_mapping( next_hop );
+  ArpEntry& entry = arp_table_.find_or_insert( next_hop );
+  auto ethernet_address = look_for_mapping( entry );
   if ( ethernet_address.has_value() ) {
-    buffer_for_sending( dgram, ethernet_address.value() );
-  } else {
-    buffer_datagrams[next_hop].push( dgram );
+    buffer_for_sending( std::move( dgram ), ethernet_address.value() );
+    return SendResult::Sent;
+  }
+  return enqueue_pending( entry, std::move( dgram ) );
+}
+
+NetworkInterface::SendResult NetworkInterface::enqueue_pending( ArpEntry& entry, InternetDatagram&& dgram )
+{
+  const size_t size = size_of( dgram );
+
+  // Would the datagram fit, once the first `count` datagrams waiting for the same next hop (of total
+  // size `bytes`) were removed?
+  const auto fits_without = [&]( size_t count, size_t bytes ) {
+    return entry.pending.size() - count < limits_.max_datagrams_per_hop
+           && entry.pending_bytes - bytes + size <= limits_.max_bytes_per_hop
+           && datagrams_pending_ - count < limits_.max_datagrams
+           && bytes_pending_ - bytes + size <= limits_.max_bytes;
+  };
+
+  if ( limits_.policy == DropPolicy::Oldest ) {
+    size_t count = 0;
+    size_t bytes = 0;
+    while ( count < entry.pending.size() && !fits_without( count, bytes ) ) {
+      bytes += size_of( entry.pending[count].datagram );
+      ++count;
+    }
+    if ( count > 0 && fits_without( count, bytes ) ) {
+      remove_pending( entry, count );
+      datagrams_dropped_ += count;
+    }
+  }
+
+  if ( !fits_without( 0, 0 ) ) {
+    ++datagrams_dropped_;
+    return SendResult::Dropped;
+  }
+
+  entry.pending.push_back( { std::move( dgram ), timestamp } );
+  entry.pending_bytes += size;
+  ++datagrams_pending_;
+  bytes_pending_ += size;
+  set_timer( entry );
+  return SendResult::Queued;
+}
+
+void NetworkInterface::remove_pending( ArpEntry& entry, const size_t count )
+{
+  for ( size_t i = 0; i < count; ++i ) {
+    const size_t size = size_of( entry.pending[i].datagram );
+    entry.pending_bytes -= size;
+    bytes_pending_ -= size;
   }
+  datagrams_pending_ -= count;
+  entry.pending.erase( entry.pending.begin(), entry.pending.begin() + static_cast<ptrdiff_t>( count ) );
 }
 
 // frame: the incoming Ethernet frame
+optional<InternetDatagram> NetworkInterface::recv_frame( EthernetFrame&& frame )
+{
+  if ( !accepts( frame.header ) ) {
+    return {};
+  }
+  return receive( frame.header, std::move( frame.payload ) );
+}
+
 optional<InternetDatagram> NetworkInterface::recv_frame( const EthernetFrame& frame )
 {
-  if ( frame.header.dst != ethernet_address_ && frame.header.dst != ETHERNET_BROADCAST ) {
+  if ( !accepts( frame.header ) ) {
     return {};
   }
+  return receive( frame.header, vector<Buffer> { frame.payload } );
+}
+
+optional<InternetDatagram> NetworkInterface::receive( const EthernetHeader& header, vector<Buffer>&& payload )
+{
   InternetDatagram dgram;
-  switch ( frame.header.type ) {
+  switch ( header.type ) {
     case EthernetHeader::TYPE_IPv4:
-      if ( parse( dgram, frame.payload ) ) {
+      if ( parse( dgram, std::move( payload ) ) ) {
         return dgram;
       }
       break;
     case EthernetHeader::TYPE_ARP:
-      handle_ARP_payload( frame.payload );
+      handle_ARP_payload( std::move( payload ) );
       break;
     default:
       cerr << "Unknown ethernet frame type\n";
@@ -56,6 +135,7 @@ optional<InternetDatagram> NetworkInterface::recv_frame( const EthernetFrame& fr
 void NetworkInterface::tick( const size_t ms_since_last_tick )
 {
   timestamp += ms_since_last_tick;
+  timers_.advance( timestamp, [this]( uint64_t deadline, uint32_t address ) { on_timer( address, deadline ); } );
 }
 
 optional<EthernetFrame> NetworkInterface::maybe_send()
@@ -63,51 +143,50 @@ optional<EthernetFrame> NetworkInterface::maybe_send()
   if ( buffer_frames.empty() ) {
     return {};
   }
-  auto frame = buffer_frames.front();
+  auto frame = std::move( buffer_frames.front() );
   buffer_frames.pop();
   return frame;
 }
-std::optional<EthernetAddress> NetworkInterface::look_for_mapping( const Address& address )
+std::optional<EthernetAddress> NetworkInterface::look_for_mapping( ArpEntry& entry )
 {
-  if ( mappings.contains( address ) ) {
-    auto& [ethernet_address, added_time] = mappings[address];
-    if ( timestamp - added_time <= EXPIRE_TIME_IN_MS ) {
-      return ethernet_address;
-    }
-    mappings.erase( address );
+  // An expired mapping has already been cleared by its timer
+  if ( entry.has_mapping ) {
+    return entry.ethernet_address;
   }
-  send_ARP_request_for( address );
+  send_ARP_request_for( entry );
   return {};
 }
 
-void NetworkInterface::buffer_for_sending( const EthernetFrame& frame )
+void NetworkInterface::buffer_for_sending( EthernetFrame&& frame )
 {
-  buffer_frames.push( frame );
+  buffer_frames.push( std::move( frame ) );
 }
 
-void NetworkInterface::buffer_for_sending( const InternetDatagram& dgram, const EthernetAddress& ethernet_address )
+void NetworkInterface::buffer_for_sending( InternetDatagram&& dgram, const EthernetAddress& ethernet_address )
 {
   EthernetFrame frame;
   frame.header.dst = ethernet_address;
   frame.header.src = ethernet_address_;
   frame.header.type = EthernetHeader::TYPE_IPv4;
-  frame.payload = serialize( dgram );
+  frame.payload = serialize( std::move( dgram ) );
 
-  buffer_for_sending( frame );
+  buffer_for_sending( std::move( frame ) );
 }
 
-void NetworkInterface::send_ARP_request_for( const Address& address )
+void NetworkInterface::send_ARP_request_for( ArpEntry& entry )
 {
-  if ( in_flight_ARP.contains( address ) && timestamp - in_flight_ARP[address] <= ARP_REQUEST_INTERVAL ) {
+  if ( entry.request_sent && timestamp - entry.request_sent_at <= ARP_REQUEST_INTERVAL ) {
     return;
   }
-  in_flight_ARP[address] = timestamp;
+  entry.request_sent = true;
+  entry.request_sent_at = timestamp;
+  set_timer( entry );
 
   ARPMessage message;
   message.opcode = ARPMessage::OPCODE_REQUEST;
   message.sender_ethernet_address = ethernet_address_;
-  message.sender_ip_address = ip_address_.ipv4_numeric();
-  message.target_ip_address = address.ipv4_numeric();
+  message.sender_ip_address = ip_address_;
+  message.target_ip_address = entry.address;
 
   EthernetFrame frame;
   frame.header.dst = ETHERNET_BROADCAST;
@@ -115,17 +194,17 @@ void NetworkInterface::send_ARP_request_for( const Address& address )
   frame.header.type = EthernetHeader::TYPE_ARP;
   frame.payload = serialize( message );
 
-  buffer_for_sending( frame );
+  buffer_for_sending( std::move( frame ) );
 }
 
-void NetworkInterface::send_ARP_reply_to( const EthernetAddress& ethernet_address, const Address& address )
+void NetworkInterface::send_ARP_reply_to( const EthernetAddress& ethernet_address, const uint32_t address )
 {
   ARPMessage message;
   message.opcode = ARPMessage::OPCODE_REPLY;
   message.sender_ethernet_address = ethernet_address_;
-  message.sender_ip_address = ip_address_.ipv4_numeric();
+  message.sender_ip_address = ip_address_;
   message.target_ethernet_address = ethernet_address;
-  message.target_ip_address = address.ipv4_numeric();
+  message.target_ip_address = address;
 
   EthernetFrame frame;
   frame.header.dst = ethernet_address;
@@ -133,30 +212,107 @@ void NetworkInterface::send_ARP_reply_to( const EthernetAddress& ethernet_addres
   frame.header.type = EthernetHeader::TYPE_ARP;
   frame.payload = serialize( message );
 
-  buffer_for_sending( frame );
+  buffer_for_sending( std::move( frame ) );
 }
 
-void NetworkInterface::add_mapping( const Address& address, const EthernetAddress& ethernet_address )
+void NetworkInterface::add_mapping( const uint32_t address, const EthernetAddress& ethernet_address )
 {
-  mappings[address] = std::make_pair( ethernet_address, timestamp );
-  if ( buffer_datagrams.contains( address ) ) {
-    auto& q = buffer_datagrams[address];
-    while ( !q.empty() ) {
-      buffer_for_sending( q.front(), ethernet_address );
-      q.pop();
-    }
-    buffer_datagrams.erase( address );
+  ArpEntry& entry = arp_table_.find_or_insert( address );
+  entry.has_mapping = true;
+  entry.ethernet_address = ethernet_address;
+  entry.mapping_expires_at = timestamp + EXPIRE_TIME_IN_MS;
+  set_timer( entry );
+
+  // All of the entry's datagrams stop waiting (accounted for before they are moved out and emptied)
+  datagrams_pending_ -= entry.pending.size();
+  bytes_pending_ -= entry.pending_bytes;
+  entry.pending_bytes = 0;
+  for ( auto& pending : entry.pending ) {
+    buffer_for_sending( std::move( pending.datagram ), ethernet_address );
   }
+  entry.pending.clear();
 }
 
-void NetworkInterface::handle_ARP_payload( const vector<Buffer>& payload )
+void NetworkInterface::handle_ARP_payload( vector<Buffer>&& payload )
 {
   ARPMessage message;
-  parse( message, payload );
+  parse( message, std::move( payload ) );
+
+  add_mapping( message.sender_ip_address, message.sender_ethernet_address );
+
+  if ( message.opcode == ARPMessage::OPCODE_REQUEST && message.target_ip_address == ip_address_ ) {
+    send_ARP_reply_to( message.sender_ethernet_address, message.sender_ip_address );
+  }
+}
+
+void NetworkInterface::unshare_buffers()
+{
+  arp_table_.for_each( []( ArpEntry& entry ) {
+    for ( auto& pending : entry.pending ) {
+      unshare( pending.datagram.payload );
+    }
+  } );
+}
 
-  add_mapping( Address::from_ipv4_numeric( message.sender_ip_address ), message.sender_ethernet_address );
+void NetworkInterface::set_timer( ArpEntry& entry )
+{
+  // A mapping is good for EXPIRE_TIME_IN_MS, and a request outstanding (or a datagram waiting) for
+  // ARP_REQUEST_INTERVAL, inclusive. The oldest datagram is the first to give up.
+  size_t deadline = SIZE_MAX;
+  if ( entry.has_mapping ) {
+    deadline = entry.mapping_expires_at + 1;
+  }
+  if ( entry.request_sent ) {
+    deadline = min( deadline, entry.request_sent_at + ARP_REQUEST_INTERVAL + 1 );
+  }
+  if ( !entry.pending.empty() ) {
+    deadline = min( deadline, entry.pending.front().queued_at + ARP_REQUEST_INTERVAL + 1 );
+  }
 
-  if ( message.opcode == ARPMessage::OPCODE_REQUEST && message.target_ip_address == ip_address_.ipv4_numeric() ) {
-    send_ARP_reply_to( message.sender_ethernet_address, Address::from_ipv4_numeric( message.sender_ip_address ) );
+  // An earlier timer that is still set will set a new one for the later deadline when it fires.
+  if ( deadline == SIZE_MAX or ( entry.timer_set && entry.timer_deadline <= deadline ) ) {
+    return;
+  }
+  entry.timer_set = true;
+  entry.timer_deadline = deadline;
+  timers_.schedule( deadline, entry.address );
+}
+
+void NetworkInterface::on_timer( const uint32_t address, const size_t deadline )
+{
+  ArpEntry* entry = arp_table_.find( address );
+  if ( entry == nullptr || !entry->timer_set || entry->timer_deadline != deadline ) {
+    return; // Replaced by a timer for an earlier deadline
+  }
+  entry->timer_set = false;
+
+  if ( entry->has_mapping && timestamp > entry->mapping_expires_at ) {
+    entry->has_mapping = false;
+  }
+  if ( entry->request_sent && timestamp - entry->request_sent_at > ARP_REQUEST_INTERVAL ) {
+    entry->request_sent = false;
+  }
+
+  // Each datagram gives up once it has waited ARP_REQUEST_INTERVAL itself, however late it arrived
+  // in the life of the request it was waiting on.
+  size_t expired = 0;
+  while ( expired < entry->pending.size()
+          && timestamp - entry->pending[expired].queued_at > ARP_REQUEST_INTERVAL ) {
+    ++expired;
+  }
+  datagrams_timed_out_ += expired;
+  remove_pending( *entry, expired );
+
+  // Datagrams that are still waiting get a new request, rather than waiting for the next datagram
+  // to the same address to send one.
+  if ( !entry->request_sent && !entry->pending.empty() ) {
+    send_ARP_request_for( *entry ); // Sets the timer
+    return;
+  }
+
+  if ( !entry->has_mapping && !entry->request_sent ) {
+    arp_table_.erase( address );
+  } else {
+    set_timer( *entry );
   }
 }
@@ -1,21 +1,16 @@
 #pragma once
 
 #include "address.hh"
+#include "arp_table.hh"
 #include "ethernet_frame.hh"
 #include "ipv4_datagram.hh"
+#include "timer_wheel.hh"
 
+#include <cstdint>
 #include <iostream>
 #include <list>
 #include <optional>
 #include <queue>
-#include <unordered_map>
-#include <utility>
-
-template<>
-struct std::hash<Address>
-{
-  size_t operator()( const Address& b ) const { return std::hash<std::string>()( b.to_string() ); }
-};
 
 // A "network interface" that connects IP (the internet layer, or network layer)
 // with Ethernet (the network access layer, or link layer).
@@ -40,6 +35,39 @@ struct std::hash<Address>
 // and learns or replies as necessary.
 class NetworkInterface
 {
+public:
+  // What send_datagram() did with a datagram.
+  //  - Sent: the next hop's Ethernet address is known, and the datagram went out in a frame.
+  //  - Queued: the datagram is waiting for an ARP reply from the next hop.
+  //  - Dropped: the datagram was dropped, because there was no room for it to wait.
+  enum class SendResult
+  {
+    Sent,
+    Queued,
+    Dropped
+  };
+
+  // Which waiting datagrams to drop when a datagram arrives that would go over the limits.
+  //  - Newest: the datagram that has just arrived.
+  //  - Oldest: the datagrams that have waited longest for the same next hop, as many as needed to
+  //    make room (falling back to Newest if that is not enough, e.g. under the global limits).
+  enum class DropPolicy
+  {
+    Newest,
+    Oldest
+  };
+
+  // Caps on the datagrams waiting for ARP replies, for each next hop and in total. A scan of an
+  // unresolvable network would otherwise queue without bound.
+  struct Limits
+  {
+    size_t max_datagrams_per_hop { 128 };
+    size_t max_bytes_per_hop { size_t { 256 } << 10 };
+    size_t max_datagrams { 4096 };
+    size_t max_bytes { size_t { 4 } << 20 };
+    DropPolicy policy { DropPolicy::Newest };
+  };
+
 private:
   // Time that a mapping is kept in cache
   static const size_t EXPIRE_TIME_IN_MS = 30000;
@@ -49,55 +77,88 @@ private:
   // It is incremented when `tick` is called and used for determining when a mapping was set up.
   size_t timestamp { 0 };
 
-  // Mappings from IP addresses to ethernet addresses and their timestamps when they were established
-  std::unordered_map<Address, std::pair<EthernetAddress, size_t>> mappings {};
+  // One timer (at most) per entry of `arp_table_`, keyed by IP address, set for the next time that
+  // its mapping expires, its ARP request times out, or a datagram gives up waiting. `tick` fires the
+  // timers that have come due, which is what evicts expired mappings and frees entries that are no
+  // longer needed.
+  TimerWheel<uint32_t> timers_ {};
 
-  // A buffer storing unsent datagrams, which will be sent immediately when an ethernet address for an
-  // IP address of a certain datagram is known.
-  std::unordered_map<Address, std::queue<InternetDatagram>> buffer_datagrams {};
+  // Datagrams dropped because no ARP reply came for their next hop in time
+  uint64_t datagrams_timed_out_ {};
+
+  // The limits on datagrams waiting for ARP replies, how many are waiting (and their total size),
+  // and how many have been dropped to stay within the limits
+  Limits limits_ {};
+  size_t datagrams_pending_ {};
+  size_t bytes_pending_ {};
+  uint64_t datagrams_dropped_ {};
+
+  // For each IP address the interface has sent to or heard from: the Ethernet address it maps to and
+  // when that mapping expires, when an ARP request for it was last sent, and the datagrams waiting
+  // for its mapping, which will be sent as soon as it is known.
+  ArpTable arp_table_ {};
 
   // A buffer storing unsent ethernet frames, which come from `buffer_datagrams` when their ethernet
   // addresses are determined. The frames will be sent when `maybe_send` is called.
   std::queue<EthernetFrame> buffer_frames {};
 
-  // All ARP requests in flight and the timestamps when they are sent
-  std::unordered_map<Address, size_t> in_flight_ARP {};
-
   // Ethernet (known as hardware, network-access, or link-layer) address of the interface
   EthernetAddress ethernet_address_;
 
   // IP (known as Internet-layer or network-layer) address of the interface
-  Address ip_address_;
+  uint32_t ip_address_;
 
   // Buffer an ethernet frame for sending
-  void buffer_for_sending( const EthernetFrame& );
-  // Buffer an internet datagram for sending
-  void buffer_for_sending( const InternetDatagram&, const EthernetAddress& );
+  void buffer_for_sending( EthernetFrame&& );
+  // Buffer an internet datagram for sending, reusing its payload (see serialize( InternetDatagram&& ))
+  void buffer_for_sending( InternetDatagram&&, const EthernetAddress& );
 
-  // Look up an existing mapping for a certain address.
+  // Look up an existing mapping for the address of an entry.
   // If it does not exist or has expired, and no previous ARP request sent within `ARP_REQUEST_INTERVAL`ms
   // is for this address, an ARP request will be sent.
-  std::optional<EthernetAddress> look_for_mapping( const Address& address );
+  std::optional<EthernetAddress> look_for_mapping( ArpEntry& entry );
+
+  // Send an ARP request for the address of an entry
+  void send_ARP_request_for( ArpEntry& );
+
+  // Have a datagram wait for the mapping of an entry, if it fits within the limits
+  SendResult enqueue_pending( ArpEntry& entry, InternetDatagram&& dgram );
+  // Forget the first `count` datagrams waiting for the mapping of an entry
+  void remove_pending( ArpEntry& entry, size_t count );
 
-  // Send an ARP request for an address
-  void send_ARP_request_for( const Address& );
+  // Make sure a timer is set for the next deadline of an entry (if it has one)
+  void set_timer( ArpEntry& );
+
+  // Handle the timer set for `deadline` for the entry for `address`: forget an expired mapping, drop
+  // the datagrams that have waited `ARP_REQUEST_INTERVAL`ms, send a new ARP request for any that are
+  // left once the last one has timed out, and remove the entry if that leaves nothing in it.
+  void on_timer( uint32_t address, size_t deadline );
   // Send an ARP reply to an ethernet address
-  void send_ARP_reply_to( const EthernetAddress&, const Address& );
+  void send_ARP_reply_to( const EthernetAddress&, uint32_t );
 
   // Add a mapping from IP address to ethernet address. If there are any buffered datagram to the
   // added IP address, buffer them for sending.
-  void add_mapping( const Address&, const EthernetAddress& );
+  void add_mapping( uint32_t, const EthernetAddress& );
 
   // Handle the payload of an ARP ethernet frame. Set up mapping for the source IP and ethernet addresses,
   // and send an ARP reply if the frame is an ARP request for our IP address.
-  void handle_ARP_payload( const std::vector<Buffer>& );
+  void handle_ARP_payload( std::vector<Buffer>&& );
+
+  // Is a frame with this header addressed to the interface?
+  bool accepts( const EthernetHeader& header ) const
+  {
+    return header.dst == ethernet_address_ || header.dst == ETHERNET_BROADCAST;
+  }
+
+  // Handle the payload of a frame addressed to the interface (see recv_frame())
+  std::optional<InternetDatagram> receive( const EthernetHeader& header, std::vector<Buffer>&& payload );
 
 public:
   // Construct a network interface with given Ethernet (network-access-layer) and IP (internet-layer)
   // addresses
   NetworkInterface( const EthernetAddress& ethernet_address, const Address& ip_address );
 
-  // Access queue of Ethernet frames awaiting transmission
+  // Access queue of Ethernet frames awaiting transmission. Frames are moved out of the queue.
   std::optional<EthernetFrame> maybe_send();
 
   // Sends an IPv4 datagram, encapsulated in an Ethernet frame (if it knows the Ethernet destination
@@ -105,14 +166,54 @@ public:
   // for the next hop.
   // ("Sending" is accomplished by making sure maybe_send() will release the frame when next called,
   // but please consider the frame sent as soon as it is generated.)
-  void send_datagram( const InternetDatagram& dgram, const Address& next_hop );
+  //
+  // A datagram passed as an rvalue is framed without copying its payload, and its header is written
+  // in place in front of the payload if there is room (as there is for a datagram parsed from a frame).
+  SendResult send_datagram( InternetDatagram&& dgram, uint32_t next_hop );
+  SendResult send_datagram( const InternetDatagram& dgram, uint32_t next_hop )
+  {
+    return send_datagram( InternetDatagram { dgram }, next_hop );
+  }
+  SendResult send_datagram( InternetDatagram&& dgram, const Address& next_hop )
+  {
+    return send_datagram( std::move( dgram ), next_hop.ipv4_numeric() );
+  }
+  SendResult send_datagram( const InternetDatagram& dgram, const Address& next_hop )
+  {
+    return send_datagram( InternetDatagram { dgram }, next_hop.ipv4_numeric() );
+  }
 
   // Receives an Ethernet frame and responds appropriately.
   // If type is IPv4, returns the datagram.
   // If type is ARP request, learn a mapping from the "sender" fields, and send an ARP reply.
   // If type is ARP reply, learn a mapping from the "sender" fields.
+  //
+  // A frame passed as an rvalue gives its payload to the datagram, which then has it to itself (and so
+  // can be sent on with its header rewritten in place, see send_datagram()).
+  std::optional<InternetDatagram> recv_frame( EthernetFrame&& frame );
   std::optional<InternetDatagram> recv_frame( const EthernetFrame& frame );
 
   // Called periodically when time elapses
   void tick( size_t ms_since_last_tick );
+
+  // Number of IP addresses the interface is keeping ARP state for
+  size_t arp_entries() const { return arp_table_.size(); }
+
+  // Number of datagrams dropped because their next hop did not answer an ARP request within
+  // `ARP_REQUEST_INTERVAL`ms of the datagram being queued
+  uint64_t datagrams_timed_out() const { return datagrams_timed_out_; }
+
+  // Cap the datagrams waiting for ARP replies (see `Limits`). Datagrams already waiting are kept.
+  void set_limits( const Limits& new_limits ) { limits_ = new_limits; }
+
+  // Number of datagrams waiting for ARP replies, and their total size in bytes
+  size_t datagrams_pending() const { return datagrams_pending_; }
+  size_t bytes_pending() const { return bytes_pending_; }
+
+  // Number of datagrams dropped to stay within the limits
+  uint64_t datagrams_dropped() const { return datagrams_dropped_; }
+
+  // Give every datagram waiting for an ARP reply Buffers of its own (see Buffer::unshare()), so that
+  // the interface can be handed to another thread
+  void unshare_buffers();
 };
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/*
+ * Read-copy-update publication of immutable snapshots, with quiescent-state-based reclamation.
+ *
+ * A writer publishes a new snapshot with a single atomic pointer store, and readers load that pointer
+ * and use the snapshot without ever taking a lock or waiting for a writer. The writer cannot free the
+ * snapshot it replaced right away, since a reader may still be using it. Instead, each registered reader
+ * announces a quiescent state (a moment at which it holds no reference to any snapshot) from time to
+ * time, and a replaced snapshot is freed once every reader has announced one since the replacement.
+ * A reader that will be idle for a while can go offline, so it does not hold up reclamation.
+ *
+ * Writers are serialized by an internal mutex. Each reader must be used by one thread at a time.
+ *
+ * The atomics use sequentially consistent ordering: a reader coming back online stores its epoch and
+ * then loads the snapshot pointer, while a writer swaps the pointer and then loads the readers' epochs,
+ * and each side must see the other's store. (On x86 this costs nothing for the readers' loads.)
+ */
+template<typename T>
+class Rcu
+{
+public:
+  static constexpr size_t MAX_READERS = 64;
+
+private:
+  static constexpr size_t CACHE_LINE_SIZE = 64;
+  static constexpr uint64_t OFFLINE = UINT64_MAX;
+
+  // The latest epoch each reader has seen at a quiescent state, on its own cache line
+  struct alignas( CACHE_LINE_SIZE ) ReaderState
+  {
+    std::atomic<uint64_t> seen_epoch { OFFLINE };
+  };
+
+  std::atomic<const T*> current_;
+  std::atomic<uint64_t> epoch_ { 1 }; // Bumped by every publication
+  std::array<ReaderState, MAX_READERS> readers_ {};
+
+  std::mutex writer_mutex_ {};
+  std::array<bool, MAX_READERS> registered_ {};
+  std::vector<std::pair<uint64_t, std::unique_ptr<const T>>> retired_ {}; // Each with the epoch it was replaced in
+  std::atomic<size_t> num_retired_ {}; // retired_.size(), for readers to check without taking the mutex
+
+  // Free every retired snapshot that no reader can still be using. The writer mutex must be held.
+  void reclaim()
+  {
+    uint64_t oldest_seen = OFFLINE;
+    for ( const auto& reader : readers_ ) {
+      oldest_seen = std::min( oldest_seen, reader.seen_epoch.load() );
+    }
+    std::erase_if( retired_, [oldest_seen]( const auto& retired ) { return retired.first <= oldest_seen; } );
+    num_retired_.store( retired_.size() );
+  }
+
+public:
+  explicit Rcu( std::unique_ptr<const T> initial ) : current_( initial.release() ) {}
+
+  Rcu( const Rcu& other ) = delete;
+  Rcu& operator=( const Rcu& other ) = delete;
+  Rcu( Rcu&& other ) = delete;
+  Rcu& operator=( Rcu&& other ) = delete;
+  ~Rcu() { delete current_.load(); }
+
+  // The current snapshot. A reader may use it until its next quiescent() or offline() call.
+  const T& read() const { return *current_.load(); }
+
+  // Register a reader (which starts out online, unless `online` is false), and return its index
+  size_t register_reader( const bool online = true )
+  {
+    const std::lock_guard lock { writer_mutex_ };
+    const auto it = std::find( registered_.begin(), registered_.end(), false );
+    if ( it == registered_.end() ) {
+      throw std::runtime_error( "Rcu: too many readers" );
+    }
+    *it = true;
+    const auto reader = static_cast<size_t>( it - registered_.begin() );
+    readers_[reader].seen_epoch.store( online ? epoch_.load() : OFFLINE );
+    return reader;
+  }
+
+  void unregister_reader( const size_t reader )
+  {
+    const std::lock_guard lock { writer_mutex_ };
+    readers_.at( reader ).seen_epoch.store( OFFLINE );
+    registered_.at( reader ) = false;
+    reclaim();
+  }
+
+  // Announce that `reader` holds no reference to any snapshot (and so has let go of replaced ones)
+  void quiescent( const size_t reader ) { readers_[reader].seen_epoch.store( epoch_.load() ); }
+
+  // Take `reader` offline until its next quiescent() call, e.g. before it blocks or sleeps
+  void offline( const size_t reader ) { readers_[reader].seen_epoch.store( OFFLINE ); }
+
+  // Replace the current snapshot. The previous one is freed once no reader can still be using it.
+  void publish( std::unique_ptr<const T> snapshot )
+  {
+    const std::lock_guard lock { writer_mutex_ };
+    std::unique_ptr<const T> previous { current_.exchange( snapshot.release() ) };
+    retired_.emplace_back( epoch_.fetch_add( 1 ) + 1, std::move( previous ) );
+    reclaim();
+  }
+
+  // Free the replaced snapshots that no reader can still be using, if there are any and no writer is
+  // busy. A reader may call this after its quiescent state or going offline, so that the snapshots
+  // replaced while it was online need not wait for the next publication to be freed.
+  void try_reclaim()
+  {
+    if ( num_retired_.load() == 0 ) {
+      return;
+    }
+    const std::unique_lock lock { writer_mutex_, std::try_to_lock };
+    if ( lock.owns_lock() ) {
+      reclaim();
+    }
+  }
+
+  // Number of replaced snapshots not yet freed
+  size_t retired()
+  {
+    const std::lock_guard lock { writer_mutex_ };
+    reclaim();
+    return retired_.size();
+  }
+
+  // Number of replaced snapshots not yet freed, without trying to free any
+  size_t retired_unreclaimed() const { return num_retired_.load(); }
+};
@@ -1,55 +1,393 @@
 #include "reassembler.hh"
 
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
 using namespace std;
 
+Reassembler::Reassembler( Storage storage ) : buffer( IntervalStorage {} )
+{
+  if ( storage == Storage::Bitmap ) {
+    buffer.emplace<BitmapStorage>();
+  }
+}
+
 void Reassembler::insert( uint64_t first_index, string data, bool is_last_substring, Writer& output )
 {
   if ( is_last_substring ) {
-    last_substring_inserted = true;
+    end_index = first_index + data.size();
+  }
+  ++inserted;
+
+  // Fast path: the substring is the next part of the stream and nothing is held, so it can be
+  // handed to the output as it is, without passing through the storage.
+  if ( first_index == front && bytes_pending() == 0 ) {
+    ++inserted_in_order;
+    data.resize( std::min( data.size(), output.available_capacity() ) );
+    front += data.size();
+    output.push( std::move( data ) );
+
+    if ( end_index.has_value() && front == end_index.value() ) {
+      output.close();
+    }
+    return;
+  }
+
+  // Trim bytes that were already written, and bytes that exceed capacity
+  const uint64_t start = std::max( first_index, front );
+  const uint64_t end = std::min( first_index + data.size(), front + output.available_capacity() );
+
+  if ( start < end ) {
+    data.resize( end - first_index );
+    data.erase( 0, start - first_index );
+
+    // The output's capacity bounds the window of held bytes: [front, front + capacity).
+    const uint64_t capacity = output.available_capacity() + output.reader().bytes_buffered();
+    data = visit(
+      [&]( auto& storage ) {
+        storage.store( capacity, start, std::move( data ) );
+        string contiguous = storage.take( front );
+        dropped += storage.enforce( limits );
+        peak_pending = std::max( peak_pending, storage.bytes_pending() );
+        return contiguous;
+      },
+      buffer );
+
+    if ( !data.empty() ) {
+      front += data.size();
+      output.push( std::move( data ) );
+    }
+  }
+
+  if ( end_index.has_value() && front == end_index.value() ) {
+    output.close();
+  }
+}
+
+uint64_t Reassembler::inserts() const
+{
+  return inserted;
+}
+
+uint64_t Reassembler::fast_path_inserts() const
+{
+  return inserted_in_order;
+}
+
+void Reassembler::set_limits( const Limits& new_limits )
+{
+  const bool caps = new_limits.max_bytes_pending != UINT64_MAX || new_limits.max_intervals != UINT64_MAX;
+  if ( caps && holds_alternative<BitmapStorage>( buffer ) ) {
+    throw runtime_error( "Reassembler::set_limits: Bitmap storage does not support limits" );
+  }
+  limits = new_limits;
+  dropped += visit( [&]( auto& storage ) { return storage.enforce( limits ); }, buffer );
+}
+
+uint64_t Reassembler::intervals_pending() const
+{
+  return visit( []( const auto& storage ) { return storage.intervals(); }, buffer );
+}
+
+uint64_t Reassembler::peak_bytes_pending() const
+{
+  return peak_pending;
+}
+
+uint64_t Reassembler::bytes_dropped() const
+{
+  return dropped;
+}
+
+uint64_t Reassembler::bytes_pending() const
+{
+  return visit( []( const auto& storage ) { return storage.bytes_pending(); }, buffer );
+}
+
+Reassembler::IntervalStorage::Segment::Segment( string data ) : size_( data.size() )
+{
+  pieces_.push_back( std::move( data ) );
+}
+
+void Reassembler::IntervalStorage::Segment::append( Segment&& next )
+{
+  pieces_.splice( pieces_.end(), next.pieces_ );
+  size_ += next.size_;
+  next.size_ = 0;
+}
+
+Reassembler::IntervalStorage::Segment Reassembler::IntervalStorage::Segment::split( uint64_t pos )
+{
+  // Move whole pieces off the back, and cut the one that `pos` falls in.
+  Segment rest;
+  while ( size_ > pos ) {
+    string& last = pieces_.back();
+    const uint64_t last_start = size_ - last.size();
+    if ( last_start >= pos ) {
+      rest.size_ += last.size();
+      rest.pieces_.splice( rest.pieces_.begin(), pieces_, std::prev( pieces_.end() ) );
+      size_ = last_start;
+    } else {
+      rest.size_ += size_ - pos;
+      rest.pieces_.push_front( last.substr( pos - last_start ) );
+      last.resize( pos - last_start );
+      size_ = pos;
+    }
+  }
+  return rest;
+}
+
+string Reassembler::IntervalStorage::Segment::release()
+{
+  string data = std::move( pieces_.front() );
+  pieces_.pop_front();
+  data.reserve( size_ );
+  for ( const auto& piece : pieces_ ) {
+    data += piece;
+  }
+  pieces_.clear();
+  size_ = 0;
+  return data;
+}
+
+void Reassembler::IntervalStorage::store( uint64_t /* capacity */, uint64_t first_index, string data )
+{
+  newest_.reset();
+  uint64_t last_index = first_index + data.size();
+
+  // Trim the front of the substring where it overlaps the preceding segment.
+  auto it = segments_.upper_bound( first_index );
+  if ( it != segments_.begin() ) {
+    const auto& [prev_index, prev_segment] = *std::prev( it );
+    const uint64_t prev_end = prev_index + prev_segment.size();
+    if ( prev_end >= last_index ) {
+      return;
+    }
+    if ( prev_end > first_index ) {
+      data.erase( 0, prev_end - first_index );
+      first_index = prev_end;
+    }
+  }
+
+  // Drop segments that the substring covers, and trim its back where it overlaps the next one.
+  while ( it != segments_.end() && it->first < last_index ) {
+    if ( it->first + it->second.size() > last_index ) {
+      data.resize( it->first - first_index );
+      last_index = it->first;
+      break;
+    }
+    bytes_pending_ -= it->second.size();
+    it = segments_.erase( it );
+  }
+
+  if ( data.empty() ) {
+    return;
   }
+  bytes_pending_ += data.size();
+  newest_ = { first_index, last_index };
 
-  if ( first_index < front ) {
-    const uint64_t to_pop = front - first_index;
-    if ( to_pop >= data.size() ) {
+  // Merge with the next segment if it starts where the substring ends, and with the preceding one if
+  // it ends where the substring starts, so that each interval of held bytes is one segment.
+  Segment segment { std::move( data ) };
+  if ( it != segments_.end() && it->first == last_index ) {
+    segment.append( std::move( it->second ) );
+    it = segments_.erase( it );
+  }
+  if ( it != segments_.begin() ) {
+    auto& [prev_index, prev_segment] = *std::prev( it );
+    if ( prev_index + prev_segment.size() == first_index ) {
+      prev_segment.append( std::move( segment ) );
       return;
     }
-    data = data.substr( to_pop );
-    first_index = 0;
-  } else {
-    first_index -= front;
-    first_index = std::min( first_index, output.available_capacity() );
   }
-  // Trim bytes that exceed capacity
-  data.resize( std::min( data.size(), output.available_capacity() - first_index ) );
-  buffer.resize( std::max( buffer.size(), first_index + data.size() ) );
+  segments_.emplace_hint( it, first_index, std::move( segment ) );
+}
+
+string Reassembler::IntervalStorage::take( uint64_t front )
+{
+  // Held segments are never adjacent, so only the first one can be contiguous with `front`.
+  auto it = segments_.begin();
+  if ( it == segments_.end() || it->first != front ) {
+    return {};
+  }
 
-  for ( uint64_t i = 0; i < data.size(); ++i ) {
-    auto& [validity, byte] = buffer[i + first_index];
-    byte = data[i];
-    bytes_valid -= validity;
-    validity = true;
-    bytes_valid += validity;
+  string data = it->second.release();
+  segments_.erase( it );
+  bytes_pending_ -= data.size();
+  if ( newest_.has_value() && newest_->first < front + data.size() ) {
+    newest_.reset();
   }
+  return data;
+}
 
-  data.clear();
-  while ( !buffer.empty() && buffer.front().first ) {
-    front += 1;
-    bytes_valid -= 1;
+uint64_t Reassembler::IntervalStorage::drop_newest( const Limits& limits )
+{
+  const auto [first, last] = newest_.value();
+  newest_.reset();
 
-    data.push_back( buffer.front().second );
-    buffer.pop_front();
+  // Just the end of them, if that is enough to get under the byte limit
+  uint64_t len = last - first;
+  if ( segments_.size() <= limits.max_intervals && bytes_pending_ - limits.max_bytes_pending < len ) {
+    len = bytes_pending_ - limits.max_bytes_pending;
   }
-  if ( !data.empty() ) {
-    output.push( data );
+
+  // The segment holding them may extend past them, when they were merged with the next one: keep
+  // that part as a segment of its own.
+  const auto it = std::prev( segments_.upper_bound( first ) );
+  const uint64_t segment_end = it->first + it->second.size();
+  if ( last < segment_end ) {
+    segments_.emplace_hint( std::next( it ), last, it->second.split( last - it->first ) );
   }
+  it->second.split( last - len - it->first );
+  if ( it->second.empty() ) {
+    segments_.erase( it );
+  }
+  bytes_pending_ -= len;
+  return len;
+}
 
-  if ( last_substring_inserted && buffer.empty() ) {
-    output.close();
+uint64_t Reassembler::IntervalStorage::enforce( const Limits& limits )
+{
+  const auto over_limits = [&] {
+    return bytes_pending_ > limits.max_bytes_pending || segments_.size() > limits.max_intervals;
+  };
+  // Drop (a suffix of) the last segment, and return how many bytes were dropped.
+  const auto drop_furthest = [&] {
+    const auto it = std::prev( segments_.end() );
+    const uint64_t first = it->first;
+    uint64_t len = it->second.size();
+    uint64_t held_end = first;
+    if ( segments_.size() <= limits.max_intervals && bytes_pending_ - limits.max_bytes_pending < len ) {
+      len = bytes_pending_ - limits.max_bytes_pending;
+      it->second.split( it->second.size() - len );
+      held_end += it->second.size();
+    } else {
+      segments_.erase( it );
+    }
+    bytes_pending_ -= len;
+
+    // The newest bytes may have been among those dropped.
+    if ( newest_.has_value() ) {
+      newest_->second = std::min( newest_->second, held_end );
+      if ( newest_->first >= newest_->second ) {
+        newest_.reset();
+      }
+    }
+    return len;
+  };
+
+  uint64_t bytes_dropped = 0;
+  if ( limits.policy == DropPolicy::Newest && newest_.has_value() && over_limits() ) {
+    bytes_dropped += drop_newest( limits );
   }
+  while ( over_limits() ) {
+    bytes_dropped += drop_furthest();
+  }
+  return bytes_dropped;
 }
 
-uint64_t Reassembler::bytes_pending() const
+void Reassembler::BitmapStorage::allocate( uint64_t capacity )
 {
-  // Your code here.
-  return bytes_valid;
+  if ( !data_.empty() ) {
+    return;
+  }
+  const uint64_t size = bit_ceil( std::max( capacity, BITS_PER_WORD ) );
+  data_.resize( size );
+  occupied_.resize( size / BITS_PER_WORD );
+  mask_ = size - 1;
+}
+
+uint64_t Reassembler::BitmapStorage::set_bits( uint64_t pos, uint64_t len )
+{
+  uint64_t newly_set = 0;
+  while ( len > 0 ) {
+    const uint64_t bit = pos % BITS_PER_WORD;
+    const uint64_t count = std::min( len, BITS_PER_WORD - bit );
+    const uint64_t bits = ( count == BITS_PER_WORD ? ~uint64_t { 0 } : ( uint64_t { 1 } << count ) - 1 ) << bit;
+
+    uint64_t& word = occupied_[pos / BITS_PER_WORD];
+    newly_set += popcount( bits & ~word );
+    word |= bits;
+
+    pos += count;
+    len -= count;
+  }
+  return newly_set;
+}
+
+void Reassembler::BitmapStorage::clear_bits( uint64_t pos, uint64_t len )
+{
+  while ( len > 0 ) {
+    const uint64_t bit = pos % BITS_PER_WORD;
+    const uint64_t count = std::min( len, BITS_PER_WORD - bit );
+    const uint64_t bits = ( count == BITS_PER_WORD ? ~uint64_t { 0 } : ( uint64_t { 1 } << count ) - 1 ) << bit;
+
+    occupied_[pos / BITS_PER_WORD] &= ~bits;
+
+    pos += count;
+    len -= count;
+  }
+}
+
+uint64_t Reassembler::BitmapStorage::run_length( uint64_t pos ) const
+{
+  const uint64_t start = pos;
+  while ( pos < data_.size() ) {
+    const uint64_t bit = pos % BITS_PER_WORD;
+    const uint64_t ones = countr_one( occupied_[pos / BITS_PER_WORD] >> bit );
+    pos += ones;
+    if ( ones < BITS_PER_WORD - bit ) {
+      break;
+    }
+  }
+  return pos - start;
+}
+
+uint64_t Reassembler::BitmapStorage::intervals() const
+{
+  // Count the set bits whose preceding bit (around the ring) is clear.
+  uint64_t runs = 0;
+  uint64_t carry = occupied_.empty() ? 0 : occupied_.back() >> ( BITS_PER_WORD - 1 );
+  for ( const uint64_t word : occupied_ ) {
+    runs += popcount( word & ~( word << 1 | carry ) );
+    carry = word >> ( BITS_PER_WORD - 1 );
+  }
+  return runs;
+}
+
+void Reassembler::BitmapStorage::store( uint64_t capacity, uint64_t first_index, string data )
+{
+  allocate( capacity );
+
+  const uint64_t offset = first_index & mask_;
+  const uint64_t first_part = std::min( static_cast<uint64_t>( data.size() ), data_.size() - offset );
+  memcpy( data_.data() + offset, data.data(), first_part );
+  memcpy( data_.data(), data.data() + first_part, data.size() - first_part );
+
+  bytes_pending_ += set_bits( offset, first_part );
+  bytes_pending_ += set_bits( 0, data.size() - first_part );
+}
+
+string Reassembler::BitmapStorage::take( uint64_t front )
+{
+  if ( bytes_pending_ == 0 ) {
+    return {};
+  }
+
+  const uint64_t offset = front & mask_;
+  uint64_t first_part = run_length( offset );
+  uint64_t second_part = 0;
+  if ( offset + first_part == data_.size() ) {
+    second_part = std::min( run_length( 0 ), offset );
+  }
+
+  string data( first_part + second_part, 0 );
+  memcpy( data.data(), data_.data() + offset, first_part );
+  memcpy( data.data() + first_part, data_.data(), second_part );
+
+  clear_bits( offset, first_part );
+  clear_bits( 0, second_part );
+  bytes_pending_ -= data.size();
+  return data;
 }
@@ -5,21 +5,139 @@
 #include <algorithm>
 #include <cassert>
 #include <iostream>
+#include <list>
+#include <map>
+#include <optional>
 #include <string>
+#include <utility>
+#include <variant>
+#include <vector>
 
 class Reassembler
 {
+public:
+  // How a Reassembler holds the bytes that arrived before the bytes preceding them.
+  //  - Intervals: an ordered map of non-overlapping segments that own their strings. Memory and
+  //    work scale with the number of segments.
+  //  - Bitmap: a ring of bytes plus one occupancy bit per byte, sized to the output's capacity
+  //    (rounded up to a power of two) when it first holds bytes. Inserting is a copy plus setting a
+  //    range of bits, whatever the arrival order.
+  enum class Storage
+  {
+    Intervals,
+    Bitmap
+  };
+
+  // Which held bytes to drop when a Reassembler goes over its limits.
+  //  - Furthest: the bytes with the highest stream indices, which would be written last.
+  //  - Newest: the bytes that have just arrived (falling back to Furthest if that is not enough).
+  enum class DropPolicy
+  {
+    Furthest,
+    Newest
+  };
+
+  // Caps on out-of-order storage, for Storage::Intervals only. The Bitmap storage allocates a ring
+  // for the output's whole capacity as soon as it holds anything, so capping what it holds would not
+  // save memory: set_limits() rejects caps with Storage::Bitmap.
+  struct Limits
+  {
+    uint64_t max_bytes_pending { UINT64_MAX };
+    uint64_t max_intervals { UINT64_MAX };
+    DropPolicy policy { DropPolicy::Furthest };
+  };
+
 private:
-  // The index of the first byte stored in the Reassembler.
+  class IntervalStorage
+  {
+    // The bytes of one interval, kept as the strings that were merged into it, so that merging
+    // intervals moves strings rather than copying bytes.
+    class Segment
+    {
+      std::list<std::string> pieces_ {};
+      uint64_t size_ { 0 };
+
+    public:
+      Segment() = default;
+      explicit Segment( std::string data );
+      uint64_t size() const { return size_; }
+      bool empty() const { return size_ == 0; }
+      // Add the bytes of `next`, which follow these ones.
+      void append( Segment&& next );
+      // Remove and return the bytes from `pos` on.
+      Segment split( uint64_t pos );
+      // Remove and return all the bytes, as one string.
+      std::string release();
+    };
+
+    // Non-overlapping, non-adjacent segments, keyed by the index of their first byte. Each one is a
+    // separate interval of held bytes.
+    std::map<uint64_t, Segment> segments_ {};
+    uint64_t bytes_pending_ { 0 };
+    // The stream indices [first, last) of the bytes added by the latest `store`, if it added any and
+    // they are still held.
+    std::optional<std::pair<uint64_t, uint64_t>> newest_ {};
+
+    // Drop (the end of) the bytes added by the latest `store`, and return how many were dropped.
+    uint64_t drop_newest( const Limits& limits );
+
+  public:
+    // Store a substring. Parts of it that are already held are trimmed off, held segments that it
+    // covers completely are replaced by it, and it is merged with the segments it touches.
+    void store( uint64_t capacity, uint64_t first_index, std::string data );
+    // Remove and return every held byte that is contiguous with `front`.
+    std::string take( uint64_t front );
+    // Drop held bytes until within `limits`, and return how many were dropped.
+    uint64_t enforce( const Limits& limits );
+    uint64_t bytes_pending() const { return bytes_pending_; }
+    uint64_t intervals() const { return segments_.size(); }
+  };
+
+  class BitmapStorage
+  {
+    static constexpr uint64_t BITS_PER_WORD = 64;
+
+    std::vector<char> data_ {};         // A ring of bytes, indexed by stream index modulo its size.
+    std::vector<uint64_t> occupied_ {}; // One bit per byte of `data_`: has the byte been stored?
+    uint64_t mask_ { 0 };
+    uint64_t bytes_pending_ { 0 };
+
+    // Allocate the ring (if it has not been already) for an output of `capacity` bytes, which is the
+    // widest that the window of held bytes can be.
+    void allocate( uint64_t capacity );
+    // Set or clear the bits for positions [pos, pos + len) of the ring, which must not wrap around.
+    // set_bits returns how many of them were not set before.
+    uint64_t set_bits( uint64_t pos, uint64_t len );
+    void clear_bits( uint64_t pos, uint64_t len );
+    // The number of consecutive set bits starting at `pos`, up to the end of the ring.
+    uint64_t run_length( uint64_t pos ) const;
+
+  public:
+    void store( uint64_t capacity, uint64_t first_index, std::string data );
+    std::string take( uint64_t front );
+    uint64_t enforce( const Limits& /* limits */ ) { return 0; } // Has none (see set_limits())
+    uint64_t bytes_pending() const { return bytes_pending_; }
+    uint64_t intervals() const; // The number of runs of held bytes
+  };
+
+  // The index of the first byte not yet written to the output.
   uint64_t front { 0 };
-  // Number of set bytes in data.
-  uint64_t bytes_valid { 0 };
-  // Whether the last substring has been inserted.
-  bool last_substring_inserted { false };
-  // A pair represents validity and data of a byte.
-  std::deque<std::pair<bool, char>> buffer {};
+  // The index just past the last byte of the stream, once the last substring has been inserted.
+  std::optional<uint64_t> end_index {};
+  // Number of calls to `insert`, and how many of them took the in-order fast path.
+  uint64_t inserted { 0 };
+  uint64_t inserted_in_order { 0 };
+  // Limits on out-of-order storage, the number of bytes dropped to stay within them, and the
+  // largest number of bytes ever held.
+  Limits limits {};
+  uint64_t dropped { 0 };
+  uint64_t peak_pending { 0 };
+  // Bytes that are waiting for earlier bytes. Everything held lies within the output's window.
+  std::variant<IntervalStorage, BitmapStorage> buffer;
 
 public:
+  explicit Reassembler( Storage storage = Storage::Intervals );
+
   /*
    * Insert a new substring to be reassembled into a ByteStream.
    *   `first_index`: the index of the first byte of the substring
@@ -44,4 +162,20 @@ public:
 
   // How many bytes are stored in the Reassembler itself?
   uint64_t bytes_pending() const;
+
+  // How many substrings have been inserted, and how many of them arrived exactly at the next index
+  // while nothing was held, and were written to the output without being stored?
+  uint64_t inserts() const;
+  uint64_t fast_path_inserts() const;
+
+  // Cap the bytes and the number of separate intervals held out of order (see `Limits`). Throws
+  // std::runtime_error if the storage is Storage::Bitmap and `new_limits` caps anything.
+  void set_limits( const Limits& new_limits );
+
+  // How many separate intervals of bytes are held?
+  uint64_t intervals_pending() const;
+  // The most bytes ever held at once.
+  uint64_t peak_bytes_pending() const;
+  // How many held bytes have been dropped to stay within the limits?
+  uint64_t bytes_dropped() const;
 };
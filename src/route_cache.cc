@@ -0,0 +1,86 @@
+#include "route_cache.hh"
+
+#include <algorithm>
+#include <bit>
+
+using namespace std;
+
+RouteCache::RouteCache( const size_t num_entries )
+  : sets_( max( bit_ceil( ( num_entries + WAYS - 1 ) / WAYS ), size_t { 2 } ) )
+  , set_bits_( static_cast<unsigned>( countr_zero( sets_.size() ) ) )
+{}
+
+void RouteCache::clear()
+{
+  ++generation_;
+  if ( generation_ == 0 ) {
+    // After the generation wraps around, entries from long ago could look valid again.
+    sets_.assign( sets_.size(), Set {} );
+    generation_ = 1;
+  }
+}
+
+void RouteCache::check_generation( const ForwardingTable& table )
+{
+  if ( table.generation() != table_generation_ ) {
+    clear();
+    table_generation_ = table.generation();
+  }
+}
+
+bool RouteCache::probe( const uint32_t address, const Route*& route )
+{
+  for ( const Entry& entry : set_of( address ).ways ) {
+    if ( entry.address == address and entry.generation == generation_ ) {
+      route = entry.route;
+      ++hits_;
+      return true;
+    }
+  }
+  ++misses_;
+  return false;
+}
+
+void RouteCache::insert( const uint32_t address, const Route* route )
+{
+  auto& ways = set_of( address ).ways;
+  copy_backward( ways.begin(), ways.end() - 1, ways.end() );
+  ways.front() = { address, generation_, route };
+}
+
+const Route* RouteCache::lookup( const ForwardingTable& table, const uint32_t address )
+{
+  check_generation( table );
+
+  const Route* route {};
+  if ( not probe( address, route ) ) {
+    route = table.lookup( address );
+    insert( address, route );
+  }
+  return route;
+}
+
+void RouteCache::lookup( const ForwardingTable& table, span<const uint32_t> addresses, span<const Route*> routes )
+{
+  check_generation( table );
+
+  miss_indices_.clear();
+  miss_addresses_.clear();
+  for ( size_t i = 0; i < addresses.size(); ++i ) {
+    if ( not probe( addresses[i], routes[i] ) ) {
+      miss_indices_.push_back( i );
+      miss_addresses_.push_back( addresses[i] );
+    }
+  }
+
+  if ( miss_indices_.empty() ) {
+    return;
+  }
+
+  miss_routes_.resize( miss_addresses_.size() );
+  table.lookup( miss_addresses_, miss_routes_ );
+  for ( size_t i = 0; i < miss_indices_.size(); ++i ) {
+    routes[miss_indices_[i]] = miss_routes_[i];
+    insert( miss_addresses_[i], miss_routes_[i] );
+  }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "forwarding_table.hh"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/*
+ * A fixed-size, set-associative cache of ForwardingTable lookups, keyed by destination address.
+ *
+ * Each set of WAYS entries fills exactly one cache line, so a hit costs a single cache-line read.
+ * Misses (including addresses with no route) are looked up in the table and inserted at the front
+ * of their set, evicting the oldest entry.
+ *
+ * The cache remembers the generation of the ForwardingTable it was filled from. When it is next
+ * used with a different table (e.g. once route changes have been published), it invalidates every
+ * entry at once by bumping its own generation, which each entry must match to be valid.
+ */
+class RouteCache
+{
+  static constexpr size_t WAYS = 4;
+  static constexpr size_t CACHE_LINE_SIZE = 64;
+
+  struct Entry
+  {
+    uint32_t address {};
+    uint32_t generation {}; // The entry is valid if this matches the cache's `generation_`
+    const Route* route {};
+  };
+
+  struct alignas( CACHE_LINE_SIZE ) Set
+  {
+    std::array<Entry, WAYS> ways {};
+  };
+  static_assert( sizeof( Set ) == CACHE_LINE_SIZE );
+
+  std::vector<Set> sets_;
+  unsigned set_bits_;
+  uint32_t generation_ { 1 };
+  uint64_t table_generation_ {};
+
+  uint64_t hits_ {};
+  uint64_t misses_ {};
+
+  // Scratch space for the misses of a batch of lookups
+  std::vector<size_t> miss_indices_ {};
+  std::vector<uint32_t> miss_addresses_ {};
+  std::vector<const Route*> miss_routes_ {};
+
+  Set& set_of( uint32_t address ) { return sets_[( address * 0x9e3779b1U ) >> ( 32 - set_bits_ )]; }
+
+  // Invalidate every entry if `table` is not the one the cache was filled from
+  void check_generation( const ForwardingTable& table );
+
+  // Look for `address` in the cache; on a hit, store its route in `route`
+  bool probe( uint32_t address, const Route*& route );
+  void insert( uint32_t address, const Route* route );
+
+public:
+  // A cache of at least `num_entries` entries (rounded up to a power-of-two number of sets)
+  explicit RouteCache( size_t num_entries );
+
+  // The route for `address` in `table`, from the cache if possible
+  const Route* lookup( const ForwardingTable& table, uint32_t address );
+
+  // Look up a batch of addresses, storing the route for `addresses[i]` in `routes[i]`. The misses
+  // are looked up in `table` together, as a batch.
+  void lookup( const ForwardingTable& table, std::span<const uint32_t> addresses, std::span<const Route*> routes );
+
+  // Invalidate every entry
+  void clear();
+
+  size_t size() const { return sets_.size() * WAYS; } // Number of entries
+  uint64_t hits() const { return hits_; }
+  uint64_t misses() const { return misses_; }
+};
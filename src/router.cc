@@ -1,7 +1,15 @@
 #include "router.hh"
 
+#include "spsc_ring.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
 #include <iostream>
 #include <limits>
+#include <string_view>
+#include <thread>
 
 using namespace std;
 
@@ -20,66 +28,330 @@ void Router::add_route( const uint32_t route_prefix,
        << static_cast<int>( prefix_length ) << " => " << ( next_hop.has_value() ? next_hop->ip() : "(direct)" )
        << " on interface " << interface_num << "\n";
 
-  std::shared_ptr<Node> node = root;
-  for ( size_t i = 0; i < prefix_length; ++i ) {
-    unsigned int bit = static_cast<bool>( route_prefix & ( 1U << ( 31 - i ) ) );
-    if ( node->next.at( bit ) == nullptr ) {
-      node->next.at( bit ) = std::make_shared<Node>();
-    }
-    node = node->next.at( bit );
+  if ( interface_num > UINT32_MAX ) {
+    throw runtime_error( "Router::add_route: interface number " + to_string( interface_num ) + " is too large" );
   }
+  const Route route { next_hop.has_value() ? next_hop->ipv4_numeric() : Route::DIRECT,
+                      static_cast<uint32_t>( interface_num ) };
 
-  node->value = { next_hop, interface_num };
+  const lock_guard lock { routes_mutex_ };
+  routing_table_.at( prefix_length ).insert_or_assign( prefix_of( route_prefix, prefix_length ), route );
+  routes_changed_ = true;
 }
 
-std::optional<std::pair<std::optional<Address>, size_t>> Router::match( uint32_t raw_address ) const
+bool Router::remove_route( const uint32_t route_prefix, const uint8_t prefix_length )
 {
-  std::optional<std::pair<std::optional<Address>, size_t>> result {};
+  const lock_guard lock { routes_mutex_ };
+  const bool removed = routing_table_.at( prefix_length ).erase( prefix_of( route_prefix, prefix_length ) );
+  if ( removed ) {
+    routes_changed_ = true;
+  }
+  return removed;
+}
 
-  std::shared_ptr<Node> node = root;
-  for ( size_t i = 0; i < 32; ++i ) {
-    if ( node->value.has_value() ) {
-      result = node->value;
+void Router::load_routes( RoutingTable routing_table )
+{
+  for ( size_t prefix_length = 0; prefix_length < routing_table.size(); ++prefix_length ) {
+    for ( const auto& [prefix, route] : routing_table[prefix_length] ) {
+      if ( prefix != prefix_of( prefix, prefix_length ) ) {
+        throw runtime_error( "Router::load_routes: prefix " + Address::from_ipv4_numeric( prefix ).ip() + "/"
+                             + to_string( prefix_length ) + " has bits set past its length" );
+      }
     }
+  }
 
-    unsigned int bit = static_cast<bool>( raw_address & ( 1U << ( 31 - i ) ) );
-    if ( node->next.at( bit ) == nullptr ) {
-      break;
-    }
-    node = node->next.at( bit );
+  const lock_guard lock { routes_mutex_ };
+  routing_table_ = std::move( routing_table );
+  publish_routes_locked();
+}
+
+void Router::publish_routes()
+{
+  const lock_guard lock { routes_mutex_ };
+  publish_routes_locked();
+}
+
+void Router::publish_routes_locked()
+{
+  forwarding_table_.publish( make_unique<const ForwardingTable>( routing_table_ ) );
+  routes_changed_ = false;
+}
+
+void Router::enable_route_cache( const size_t num_entries )
+{
+  route_cache_entries_ = num_entries;
+  if ( route_cache_ ) {
+    parallel_cache_hits_ += route_cache_->hits();
+    parallel_cache_misses_ += route_cache_->misses();
   }
+  route_cache_.reset();
+  if ( num_entries > 0 ) {
+    route_cache_.emplace( num_entries );
+  }
+}
 
-  if ( node->value.has_value() ) {
-    result = node->value;
+void Router::lookup_routes( optional<RouteCache>& cache,
+                            span<const uint32_t> destinations,
+                            span<const Route*> matches ) const
+{
+  const ForwardingTable& table = forwarding_table_.read();
+  if ( cache ) {
+    cache->lookup( table, destinations, matches );
+  } else {
+    table.lookup( destinations, matches );
   }
-  return result;
 }
 
-void Router::route_datagram( InternetDatagram&& dgram )
+void Router::route_datagram( const ForwardingTable& table, InternetDatagram&& datagram )
 {
-  InternetDatagram datagram = std::move( dgram );
   if ( datagram.header.ttl <= 1U ) {
     return;
   }
-  datagram.header.ttl -= 1;
-  datagram.header.compute_checksum();
+  datagram.header.decrement_ttl();
 
-  auto matching = match( dgram.header.dst );
-  if ( matching.has_value() ) {
-    const auto& [next_hop, interface_num] = matching.value();
-    Address address = next_hop.has_value() ? next_hop.value() : Address::from_ipv4_numeric( datagram.header.dst );
-
-    interface( interface_num ).send_datagram( datagram, address );
+  const uint32_t dst = datagram.header.dst;
+  const Route* route = route_cache_ ? route_cache_->lookup( table, dst ) : table.lookup( dst );
+  if ( not route ) {
+    return;
   }
+  interface( route->interface_num ).send_datagram( std::move( datagram ), route->next_hop_for( dst ) );
 }
 
 void Router::route()
 {
+  if ( routes_changed_ ) {
+    const unique_lock lock { routes_mutex_, try_to_lock };
+    if ( lock.owns_lock() ) {
+      publish_routes_locked();
+    }
+  }
+  forwarding_table_.quiescent( reader_ ); // Online until the end of this call
+  const ForwardingTable& table = forwarding_table_.read();
+
   for ( size_t i = 0; i < interfaces_.size(); ++i ) {
     auto dgram = interface( i ).maybe_receive();
     while ( dgram.has_value() ) {
-      route_datagram( std::move( dgram.value() ) );
+      route_datagram( table, std::move( dgram.value() ) );
       dgram = interface( i ).maybe_receive();
     }
   }
+
+  // Every Route pointer from the lookups above is dead, so every replaced snapshot may be freed.
+  forwarding_table_.offline( reader_ );
+  forwarding_table_.try_reclaim();
+}
+
+namespace {
+
+// A hash of a datagram's flow: its addresses and protocol, plus its ports for TCP and UDP.
+uint64_t flow_hash( const InternetDatagram& datagram )
+{
+  constexpr uint8_t PROTO_UDP = 17;
+  const IPv4Header& header = datagram.header;
+
+  uint64_t hash = ( uint64_t { header.src } << 32 | header.dst ) ^ uint64_t { header.proto } << 24;
+  if ( ( header.proto == IPv4Header::PROTO_TCP or header.proto == PROTO_UDP ) and not datagram.payload.empty()
+       and datagram.payload.front().size() >= sizeof( uint32_t ) ) {
+    uint32_t ports {};
+    memcpy( &ports, string_view { datagram.payload.front() }.data(), sizeof( ports ) );
+    hash ^= uint64_t { ports } * 0x9e3779b97f4a7c15;
+  }
+
+  // Mix the bits (the finalizer of MurmurHash3), so that the low bits depend on every field
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccd;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+} // namespace
+
+// The state shared by the workers of one route_parallel() call
+struct Router::ParallelRun
+{
+  static constexpr size_t RING_CAPACITY = 1024;
+
+  size_t num_workers;
+  std::atomic<uint64_t> remaining; // Datagrams not yet sent or dropped
+
+  // The rings from worker `from` to worker `to` are at index `from * num_workers + to`.
+  std::vector<std::unique_ptr<SpscRing<InternetDatagram>>> to_route {}; // Received, to be routed
+  std::vector<std::unique_ptr<SpscRing<Forward>>> to_send {};           // Routed, to be sent
+
+  ParallelRun( size_t workers, uint64_t datagrams ) : num_workers( workers ), remaining( datagrams )
+  {
+    for ( size_t i = 0; i < num_workers * num_workers; ++i ) {
+      to_route.push_back( make_unique<SpscRing<InternetDatagram>>( RING_CAPACITY ) );
+      to_send.push_back( make_unique<SpscRing<Forward>>( RING_CAPACITY ) );
+    }
+  }
+};
+
+// The private state of one worker. When a ring to another worker is full, datagrams for that worker
+// wait in an overflow queue (which is drained before the ring is used again, to keep them in order),
+// and the worker stops taking in more work of the same kind until the queue is empty.
+struct Router::Worker
+{
+  size_t index;
+  size_t reader; // The worker's Rcu reader of the forwarding table
+
+  std::vector<InternetDatagram> batch {};
+  std::vector<uint32_t> destinations {};
+  std::vector<const Route*> matches {};
+  std::optional<RouteCache> cache {};
+
+  std::vector<std::deque<InternetDatagram>> to_route_overflow {};
+  std::vector<std::deque<Forward>> to_send_overflow {};
+};
+
+void Router::route_parallel( size_t num_workers )
+{
+  num_workers = max( num_workers, size_t { 1 } );
+
+  if ( routes_changed_ ) {
+    const unique_lock lock { routes_mutex_, try_to_lock };
+    if ( lock.owns_lock() ) {
+      publish_routes_locked();
+    }
+  }
+
+  // Buffers count their references non-atomically, so none that a worker may let go of can be
+  // shared with one that another worker may let go of.
+  uint64_t waiting = 0;
+  for ( auto& interface : interfaces_ ) {
+    interface.unshare_buffers();
+    waiting += interface.datagrams_waiting();
+  }
+  ParallelRun run { num_workers, waiting };
+
+  vector<Worker> workers;
+  for ( size_t i = 0; i < num_workers; ++i ) {
+    workers.push_back( { i,
+                         forwarding_table_.register_reader(),
+                         {},
+                         {},
+                         {},
+                         {},
+                         vector<deque<InternetDatagram>>( num_workers ),
+                         vector<deque<Forward>>( num_workers ) } );
+    if ( route_cache_entries_ > 0 ) {
+      workers.back().cache.emplace( route_cache_entries_ );
+    }
+  }
+
+  vector<thread> threads;
+  for ( size_t i = 1; i < num_workers; ++i ) {
+    threads.emplace_back( [&, i] { run_worker( run, workers[i] ); } );
+  }
+  run_worker( run, workers[0] );
+  for ( auto& t : threads ) {
+    t.join();
+  }
+
+  for ( const auto& worker : workers ) {
+    forwarding_table_.unregister_reader( worker.reader );
+    if ( worker.cache ) {
+      parallel_cache_hits_ += worker.cache->hits();
+      parallel_cache_misses_ += worker.cache->misses();
+    }
+  }
+}
+
+void Router::run_worker( ParallelRun& run, Worker& worker )
+{
+  const size_t me = worker.index;
+  const size_t num_workers = run.num_workers;
+  const auto owner = [num_workers]( size_t interface_num ) { return interface_num % num_workers; };
+
+  // Push onto a ring to another worker, or onto its overflow queue if that is not empty or the ring is full
+  const auto hand_off = []( auto& ring, auto& overflow, auto&& item ) {
+    if ( not overflow.empty() or not ring.try_push( std::move( item ) ) ) {
+      overflow.push_back( std::move( item ) );
+    }
+  };
+  const auto flush = []( auto& ring, auto& overflow ) {
+    while ( not overflow.empty() and ring.try_push( std::move( overflow.front() ) ) ) {
+      overflow.pop_front();
+    }
+    return overflow.empty();
+  };
+
+  Forward forward;
+  while ( run.remaining.load( memory_order_acquire ) > 0 ) {
+    uint64_t done = 0;
+
+    bool to_route_flushed = true;
+    bool to_send_flushed = true;
+    for ( size_t to = 0; to < num_workers; ++to ) {
+      to_route_flushed &= flush( *run.to_route[me * num_workers + to], worker.to_route_overflow[to] );
+      to_send_flushed &= flush( *run.to_send[me * num_workers + to], worker.to_send_overflow[to] );
+    }
+
+    // Receive from this worker's interfaces, and hand each datagram to the worker for its flow.
+    if ( to_route_flushed ) {
+      for ( size_t i = me; i < interfaces_.size(); i += num_workers ) {
+        for ( size_t n = 0; n < BATCH_SIZE; ++n ) {
+          auto dgram = interface( i ).maybe_receive();
+          if ( not dgram.has_value() ) {
+            break;
+          }
+          const size_t to = flow_hash( dgram.value() ) % num_workers;
+          auto& ring = *run.to_route[me * num_workers + to];
+          hand_off( ring, worker.to_route_overflow[to], std::move( dgram.value() ) );
+        }
+      }
+    }
+
+    // Route the datagrams handed to this worker, and hand each to the owner of its output interface.
+    if ( to_send_flushed ) {
+      worker.batch.clear();
+      for ( size_t from = 0; from < num_workers; ++from ) {
+        auto& ring = *run.to_route[from * num_workers + me];
+        InternetDatagram datagram;
+        while ( worker.batch.size() < BATCH_SIZE and ring.try_pop( datagram ) ) {
+          worker.batch.push_back( std::move( datagram ) );
+        }
+      }
+
+      done += erase_if( worker.batch, []( const InternetDatagram& dgram ) { return dgram.header.ttl <= 1U; } );
+      worker.destinations.clear();
+      for ( auto& datagram : worker.batch ) {
+        datagram.header.decrement_ttl();
+        worker.destinations.push_back( datagram.header.dst );
+      }
+      worker.matches.resize( worker.batch.size() );
+      lookup_routes( worker.cache, worker.destinations, worker.matches );
+
+      for ( size_t i = 0; i < worker.batch.size(); ++i ) {
+        const Route* matched = worker.matches[i];
+        if ( not matched ) {
+          ++done;
+          continue;
+        }
+        const uint32_t next_hop = matched->next_hop_for( worker.batch[i].header.dst );
+        const size_t to = owner( matched->interface_num );
+        hand_off( *run.to_send[me * num_workers + to],
+                  worker.to_send_overflow[to],
+                  Forward { std::move( worker.batch[i] ), next_hop, matched->interface_num } );
+      }
+    }
+    forwarding_table_.quiescent( worker.reader );
+
+    // Send the datagrams routed to this worker's interfaces.
+    for ( size_t from = 0; from < num_workers; ++from ) {
+      auto& ring = *run.to_send[from * num_workers + me];
+      while ( ring.try_pop( forward ) ) {
+        interface( forward.interface_num ).send_datagram( std::move( forward.datagram ), forward.next_hop );
+        ++done;
+      }
+    }
+
+    if ( done > 0 ) {
+      run.remaining.fetch_sub( done, memory_order_acq_rel );
+    } else {
+      this_thread::yield();
+    }
+  }
+
+  forwarding_table_.offline( worker.reader );
 }
@@ -1,9 +1,16 @@
 #pragma once
 
+#include "forwarding_table.hh"
 #include "network_interface.hh"
+#include "rcu.hh"
+#include "route_cache.hh"
 
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <optional>
-#include <queue>
+#include <span>
 
 // A wrapper for NetworkInterface that makes the host-side
 // interface asynchronous: instead of returning received datagrams
@@ -12,13 +19,20 @@
 // implementation of NetworkInterface.
 class AsyncNetworkInterface : public NetworkInterface
 {
-  std::queue<InternetDatagram> datagrams_in_ {};
+  std::deque<InternetDatagram> datagrams_in_ {};
+
+  void keep( std::optional<InternetDatagram>&& optional_dgram )
+  {
+    if ( optional_dgram.has_value() ) {
+      datagrams_in_.push_back( std::move( optional_dgram.value() ) );
+    }
+  }
 
 public:
   using NetworkInterface::NetworkInterface;
 
   // Construct from a NetworkInterface
-  explicit AsyncNetworkInterface( NetworkInterface&& interface ) : NetworkInterface( interface ) {}
+  explicit AsyncNetworkInterface( NetworkInterface&& interface ) : NetworkInterface( std::move( interface ) ) {}
 
   // \brief Receives and Ethernet frame and responds appropriately.
 
@@ -26,14 +40,12 @@ public:
   // - If type is ARP request, learn a mapping from the "sender" fields, and send an ARP reply.
   // - If type is ARP reply, learn a mapping from the "target" fields.
   //
-  // \param[in] frame the incoming Ethernet frame
-  void recv_frame( const EthernetFrame& frame )
-  {
-    auto optional_dgram = NetworkInterface::recv_frame( frame );
-    if ( optional_dgram.has_value() ) {
-      datagrams_in_.push( std::move( optional_dgram.value() ) );
-    }
-  };
+  // \param[in] frame the incoming Ethernet frame (see NetworkInterface::recv_frame for an rvalue one)
+  void recv_frame( EthernetFrame&& frame ) { keep( NetworkInterface::recv_frame( std::move( frame ) ) ); }
+  void recv_frame( const EthernetFrame& frame ) { keep( NetworkInterface::recv_frame( frame ) ); }
+
+  // Number of received datagrams waiting to be retrieved
+  size_t datagrams_waiting() const { return datagrams_in_.size(); }
 
   // Access queue of Internet datagrams that have been received
   std::optional<InternetDatagram> maybe_receive()
@@ -43,9 +55,19 @@ public:
     }
 
     InternetDatagram datagram = std::move( datagrams_in_.front() );
-    datagrams_in_.pop();
+    datagrams_in_.pop_front();
     return datagram;
   }
+
+  // Give every datagram, received or waiting to be sent, Buffers of its own (see Buffer::unshare()),
+  // so that the interface can be handed to another thread
+  void unshare_buffers()
+  {
+    NetworkInterface::unshare_buffers();
+    for ( auto& datagram : datagrams_in_ ) {
+      unshare( datagram.payload );
+    }
+  }
 };
 
 // A router that has multiple network interfaces and
@@ -56,23 +78,54 @@ class Router
   // The router's collection of network interfaces
   std::vector<AsyncNetworkInterface> interfaces_ {};
 
-  // This abstracts nodes of a trie. Trie is a kind of data structure that
-  // can be used to match prefixes.
-  struct Node
+  // The routes as configured, guarded by `routes_mutex_`. Changes take effect once publish_routes()
+  // compiles them into a new ForwardingTable; route() does that itself when it finds changes pending,
+  // unless another thread is in the middle of updating the routes.
+  std::mutex routes_mutex_ {};
+  RoutingTable routing_table_ {};
+  std::atomic<bool> routes_changed_ {};
+
+  // The published ForwardingTable, an immutable snapshot that route() reads without taking a lock.
+  // route()'s reader is online only while route() runs, so a snapshot replaced between calls is freed
+  // by its publication, and one replaced during a call is freed as that call returns.
+  Rcu<ForwardingTable> forwarding_table_ { std::make_unique<const ForwardingTable>() };
+  size_t reader_ { forwarding_table_.register_reader( false ) };
+
+  // Compile the routing table into a new ForwardingTable and publish it. `routes_mutex_` must be held.
+  void publish_routes_locked();
+
+  // Send a datagram to the appropriate interface and address, looking up its route in `table`.
+  void route_datagram( const ForwardingTable& table, InternetDatagram&& datagram );
+
+  // The workers of route_parallel() take up to BATCH_SIZE datagrams at a time from each interface
+  // and each ring.
+  static constexpr size_t BATCH_SIZE = 32;
+
+  // An optional cache of recent lookups in front of the forwarding table (see enable_route_cache()).
+  // Each worker of route_parallel() has its own, and adds its hits and misses to the totals here.
+  size_t route_cache_entries_ {};
+  std::optional<RouteCache> route_cache_ {};
+  uint64_t parallel_cache_hits_ {};
+  uint64_t parallel_cache_misses_ {};
+
+  // Look up `destinations` in the forwarding table, through `cache` if there is one
+  void lookup_routes( std::optional<RouteCache>& cache,
+                      std::span<const uint32_t> destinations,
+                      std::span<const Route*> matches ) const;
+
+  // A routed datagram on its way to the worker that owns its output interface (see route_parallel())
+  struct Forward
   {
-    std::array<std::shared_ptr<Node>, 2> next { nullptr, nullptr };
-    std::optional<std::pair<std::optional<Address>, size_t>> value {};
+    InternetDatagram datagram {};
+    uint32_t next_hop {};
+    size_t interface_num {};
   };
 
-  // The root node of the trie.
-  std::shared_ptr<Node> root { std::make_shared<Node>() };
-
-  // Perform a longest prefix matching and return the matched Address and
-  // interface_num if found.
-  std::optional<std::pair<std::optional<Address>, size_t>> match( uint32_t raw_address ) const;
+  struct ParallelRun;
+  struct Worker;
 
-  // Send a single internet datagram to appropriate interface and address.
-  void route_datagram( InternetDatagram&& dgram );
+  // Receive, route and send datagrams as worker `worker.index` of `run`, until every datagram is done.
+  void run_worker( ParallelRun& run, Worker& worker );
 
 public:
   // Add an interface to the router
@@ -87,12 +140,40 @@ public:
   // Access an interface by index
   AsyncNetworkInterface& interface( size_t N ) { return interfaces_.at( N ); }
 
-  // Add a route (a forwarding rule)
+  // Add a route (a forwarding rule), replacing any existing route for the same prefix
   void add_route( uint32_t route_prefix,
                   uint8_t prefix_length,
                   std::optional<Address> next_hop,
                   size_t interface_num );
 
+  // Remove the route for a prefix. Returns whether there was one.
+  bool remove_route( uint32_t route_prefix, uint8_t prefix_length );
+
+  // Replace every route at once (e.g. with a full table) and publish the result immediately. Each
+  // prefix must already be masked to its length, as by prefix_of().
+  void load_routes( RoutingTable routing_table );
+
+  // Make the changes made by add_route() and remove_route() visible to route(). A control plane
+  // running on another thread than route() should call this after each burst of changes; the
+  // ForwardingTable is rebuilt once per call, however many changes there were.
+  void publish_routes();
+
+  // Put a cache of `num_entries` recent lookups (by destination address) in front of the forwarding
+  // table, or remove the cache if `num_entries` is 0. The cache is emptied whenever changed routes are
+  // published. It is off by default: a DIR-16-8-8 lookup reads at most three entries, and on
+  // router_speed_test the cache is slower than the bare forwarding table even at an 86% hit rate.
+  void enable_route_cache( size_t num_entries );
+
+  // Number of replaced ForwardingTables not yet freed
+  size_t retired_forwarding_tables() const { return forwarding_table_.retired_unreclaimed(); }
+
+  // Lookups answered by the route cache, and lookups that missed it and went to the forwarding table
+  uint64_t route_cache_hits() const { return parallel_cache_hits_ + ( route_cache_ ? route_cache_->hits() : 0 ); }
+  uint64_t route_cache_misses() const
+  {
+    return parallel_cache_misses_ + ( route_cache_ ? route_cache_->misses() : 0 );
+  }
+
   // Route packets between the interfaces. For each interface, use the
   // maybe_receive() method to consume every incoming datagram and
   // send it on one of interfaces to the correct next hop. The router
@@ -100,4 +181,18 @@ public:
   // route with the longest prefix_length that matches the datagram's
   // destination address.
   void route();
+
+  // Route every datagram waiting on the interfaces, as route() does, but with `num_workers` threads
+  // (the calling thread and `num_workers - 1` more), and return once all of them are sent or dropped.
+  //
+  // Worker w owns the interfaces whose index is w modulo `num_workers`: only it receives from them
+  // or sends on them. Each datagram it receives is handed to the worker chosen by a hash of the
+  // datagram's flow (its addresses, protocol and ports), which routes it and hands it on to the
+  // owner of its output interface. Datagrams travel between workers through single-producer/single-
+  // consumer rings, one per pair of workers, so datagrams of one flow leave in the order they arrived.
+  //
+  // No other thread may use the interfaces while this runs. Before the workers start, the datagrams
+  // on the interfaces are given Buffers of their own (see Buffer), so that the caller may keep
+  // copies of them.
+  void route_parallel( size_t num_workers );
 };
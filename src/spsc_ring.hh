@@ -0,0 +1,67 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/*
+ * A bounded single-producer/single-consumer queue of T, for handing objects from one thread to
+ * another without locks. As in ConcurrentByteStream, only the producer advances `pushed_` and only
+ * the consumer advances `popped_`, and each publishes its progress with a release store that the
+ * other side picks up with an acquire load. Each side also keeps a private copy of the other side's
+ * counter, and only reloads the shared one when that copy says the ring is full (or empty).
+ */
+template<typename T>
+class SpscRing
+{
+  static constexpr size_t CACHE_LINE_SIZE = 64;
+
+  std::vector<T> slots_;
+  uint64_t mask_;
+
+  alignas( CACHE_LINE_SIZE ) std::atomic<uint64_t> pushed_ { 0 };
+  uint64_t producer_popped_ { 0 }; // The producer's last look at `popped_`
+
+  alignas( CACHE_LINE_SIZE ) std::atomic<uint64_t> popped_ { 0 };
+  uint64_t consumer_pushed_ { 0 }; // The consumer's last look at `pushed_`
+
+public:
+  // A ring holding at least `capacity` objects (rounded up to a power of two)
+  explicit SpscRing( const size_t capacity )
+    : slots_( std::bit_ceil( std::max( capacity, size_t { 1 } ) ) ), mask_( slots_.size() - 1 )
+  {}
+
+  // Producer: push `value` unless the ring is full. Returns whether it was pushed.
+  bool try_push( T&& value )
+  {
+    const uint64_t tail = pushed_.load( std::memory_order_relaxed );
+    if ( tail - producer_popped_ == slots_.size() ) {
+      producer_popped_ = popped_.load( std::memory_order_acquire );
+      if ( tail - producer_popped_ == slots_.size() ) {
+        return false;
+      }
+    }
+    slots_[tail & mask_] = std::move( value );
+    pushed_.store( tail + 1, std::memory_order_release );
+    return true;
+  }
+
+  // Consumer: pop the oldest object into `value` unless the ring is empty. Returns whether one was popped.
+  bool try_pop( T& value )
+  {
+    const uint64_t head = popped_.load( std::memory_order_relaxed );
+    if ( head == consumer_pushed_ ) {
+      consumer_pushed_ = pushed_.load( std::memory_order_acquire );
+      if ( head == consumer_pushed_ ) {
+        return false;
+      }
+    }
+    value = std::move( slots_[head & mask_] );
+    popped_.store( head + 1, std::memory_order_release );
+    return true;
+  }
+};
@@ -4,6 +4,9 @@
 #include "tcp_receiver_message.hh"
 #include "tcp_sender_message.hh"
 
+#include <memory>
+#include <queue>
+
 /*
  * The Timer class used for determining when to resend an outstanding message.
  */
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/*
+ * A hierarchical timer wheel: a set of values, each with a deadline (in ms), that hands back the
+ * values whose deadlines have passed as time advances.
+ *
+ * There are LEVELS wheels of SLOTS slots. A timer goes on the lowest level whose slots are fine
+ * enough to tell its deadline apart from the current time: level 0 holds the timers due within
+ * the current run of SLOTS ms, one slot per ms, level 1 those due within the current run of
+ * SLOTS * SLOTS ms, one slot per SLOTS ms, and so on. When time reaches a slot on a higher level,
+ * its timers move down to a lower one. A bitmap of non-empty slots per level lets advance() jump
+ * straight to the next slot with timers in it, so advancing costs O(1) per timer that fires or
+ * moves down, however much time passes.
+ *
+ * Deadlines more than HORIZON ms ahead are moved in to HORIZON ms ahead.
+ */
+template<typename T>
+class TimerWheel
+{
+  static constexpr unsigned SLOT_BITS = 6;
+  static constexpr size_t SLOTS = size_t { 1 } << SLOT_BITS;
+  static constexpr unsigned LEVELS = 4;
+
+public:
+  static constexpr uint64_t HORIZON = ( uint64_t { 1 } << ( SLOT_BITS * LEVELS ) ) - 1; // About 4.6 hours
+
+private:
+  struct Timer
+  {
+    uint64_t deadline;
+    T value;
+  };
+
+  std::array<std::array<std::vector<Timer>, SLOTS>, LEVELS> slots_ {};
+  std::array<uint64_t, LEVELS> occupied_ {}; // Bit i of level l is set if slot i of level l has timers
+  uint64_t now_;                             // Every timer due at or before `now_` has fired
+  size_t size_ {};
+  std::vector<Timer> due_ {}; // The timers of the slot being emptied
+
+  static size_t slot_index( const uint64_t time, const unsigned level )
+  {
+    return ( time >> ( SLOT_BITS * level ) ) & ( SLOTS - 1 );
+  }
+
+  void insert( Timer&& timer )
+  {
+    // The highest group of SLOT_BITS bits in which the deadline differs from the current time
+    const auto differing_bits = static_cast<unsigned>( std::bit_width( timer.deadline ^ now_ ) );
+    const unsigned level = std::min( ( differing_bits - 1 ) / SLOT_BITS, LEVELS - 1 );
+    const size_t index = slot_index( timer.deadline, level );
+    slots_[level][index].push_back( std::move( timer ) );
+    occupied_[level] |= uint64_t { 1 } << index;
+  }
+
+  // The start of the next slot with timers in it, or false if there are no timers. Every non-empty
+  // slot on a level below the top one is later in the current run of that level than the slot of
+  // `now_`; a non-empty slot on the top level at or before the slot of `now_` is in the next run.
+  bool next_slot( uint64_t& start, unsigned& level, size_t& index ) const
+  {
+    for ( level = 0; level < LEVELS; ++level ) {
+      const size_t current = slot_index( now_, level );
+      const uint64_t later = occupied_[level] & ~( ( uint64_t { 2 } << current ) - 1 );
+      const unsigned run_bits = SLOT_BITS * ( level + 1 );
+      uint64_t run_start = now_ >> run_bits << run_bits;
+
+      if ( later != 0 ) {
+        index = static_cast<size_t>( std::countr_zero( later ) );
+      } else if ( level == LEVELS - 1 and occupied_[level] != 0 ) {
+        index = static_cast<size_t>( std::countr_zero( occupied_[level] ) );
+        run_start += uint64_t { 1 } << run_bits;
+      } else {
+        continue;
+      }
+
+      start = run_start | uint64_t { index } << ( SLOT_BITS * level );
+      return true;
+    }
+    return false;
+  }
+
+public:
+  explicit TimerWheel( const uint64_t now = 0 ) : now_( now ) {}
+
+  uint64_t now() const { return now_; }
+  size_t size() const { return size_; }
+
+  // Add a timer. A deadline at or before now() fires at the next advance().
+  void schedule( const uint64_t deadline, T value )
+  {
+    insert( { std::clamp( deadline, now_ + 1, now_ + HORIZON ), std::move( value ) } );
+    ++size_;
+  }
+
+  // Advance the current time to `time`, calling `fire( deadline, value )` for each timer due by
+  // then, in order of deadline. `fire` may schedule more timers.
+  template<typename F>
+  void advance( const uint64_t time, F&& fire )
+  {
+    uint64_t start {};
+    unsigned level {};
+    size_t index {};
+    while ( now_ < time and next_slot( start, level, index ) and start <= time ) {
+      now_ = start;
+      due_.swap( slots_[level][index] );
+      occupied_[level] &= ~( uint64_t { 1 } << index );
+
+      for ( auto& timer : due_ ) {
+        if ( timer.deadline <= now_ ) {
+          --size_;
+          fire( timer.deadline, std::move( timer.value ) );
+        } else {
+          insert( std::move( timer ) );
+        }
+      }
+      due_.clear();
+    }
+    now_ = std::max( now_, time );
+  }
+};
@@ -0,0 +1,78 @@
+#include "arp_table.hh"
+#include "random.hh"
+#include "test_should_be.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    // Entries are found after insertion, and gone after erasure
+    {
+      ArpTable table;
+      test_should_be( table.find( 0x0a000001 ) == nullptr, true );
+      ArpEntry& entry = table.find_or_insert( 0x0a000001 );
+      test_should_be( entry.address, uint32_t { 0x0a000001 } );
+      test_should_be( entry.has_mapping, false );
+      entry.ethernet_address = { 1, 2, 3, 4, 5, 6 };
+      entry.pending.emplace_back();
+
+      test_should_be( table.size(), size_t { 1 } );
+      test_should_be( table.find( 0x0a000001 )->ethernet_address[5], uint8_t { 6 } );
+      test_should_be( &table.find_or_insert( 0x0a000001 ) == table.find( 0x0a000001 ), true );
+      test_should_be( table.size(), size_t { 1 } );
+
+      table.erase( 0x0a000002 );
+      test_should_be( table.size(), size_t { 1 } );
+      table.erase( 0x0a000001 );
+      test_should_be( table.size(), size_t { 0 } );
+      test_should_be( table.find( 0x0a000001 ) == nullptr, true );
+
+      // A reinserted address starts afresh
+      test_should_be( table.find_or_insert( 0x0a000001 ).pending.size(), size_t { 0 } );
+    }
+
+    // Random insertions and erasures (over a small range, so that probe sequences collide) agree
+    // with std::unordered_map, while the table grows
+    {
+      ArpTable table;
+      unordered_map<uint32_t, uint64_t> reference;
+      uniform_int_distribution<uint32_t> address_dist { 0, 3000 };
+      for ( uint64_t i = 0; i < 50'000; ++i ) {
+        const uint32_t address = address_dist( rd ) * 256;
+        if ( rd() % 3 == 0 ) {
+          table.erase( address );
+          reference.erase( address );
+        } else {
+          table.find_or_insert( address ).request_sent_at = i;
+          reference[address] = i;
+        }
+
+        if ( i % 1000 == 0 ) {
+          test_should_be( table.size(), reference.size() );
+          for ( uint32_t a = 0; a <= 3000 * 256; a += 256 ) {
+            const ArpEntry* entry = table.find( a );
+            const auto it = reference.find( a );
+            test_should_be( entry != nullptr, it != reference.end() );
+            if ( entry ) {
+              test_should_be( entry->request_sent_at, it->second );
+            }
+          }
+        }
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,121 @@
+#include "buffer.hh"
+#include "ipv4_datagram.hh"
+#include "parser.hh"
+#include "test_should_be.hh"
+
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+string concatenate( const vector<Buffer>& buffers )
+{
+  string bytes;
+  for ( const auto& buffer : buffers ) {
+    bytes += string_view { buffer };
+  }
+  return bytes;
+}
+
+InternetDatagram make_datagram( const string& payload )
+{
+  InternetDatagram dgram;
+  dgram.header.proto = 17;
+  dgram.header.src = 0x0a000102;
+  dgram.header.dst = 0x0a000202;
+  dgram.header.len = static_cast<uint16_t>( dgram.header.hlen * 4 + payload.size() );
+  dgram.header.ttl = 64;
+  dgram.header.compute_checksum();
+  dgram.payload.emplace_back( payload );
+  return dgram;
+}
+
+int main()
+{
+  try {
+    // Removing a prefix turns it into headroom, which prepend() takes back
+    {
+      Buffer buffer { "headerpayload" };
+      test_should_be( buffer.headroom(), size_t { 0 } );
+      test_should_be( buffer.can_prepend( 1 ), false );
+
+      buffer.remove_prefix( 6 );
+      test_should_be( buffer.size(), size_t { 7 } );
+      test_should_be( buffer.headroom(), size_t { 6 } );
+      test_should_be( string_view { buffer } == "payload", true );
+      test_should_be( buffer.can_prepend( 6 ), true );
+      test_should_be( buffer.can_prepend( 7 ), false );
+
+      const auto header = buffer.prepend( 3 );
+      header[0] = 'n';
+      header[1] = 'e';
+      header[2] = 'w';
+      test_should_be( string_view { buffer } == "newpayload", true );
+      test_should_be( buffer.headroom(), size_t { 3 } );
+
+      // Converting to a string gives up the headroom
+      const string& str = buffer;
+      test_should_be( str == "newpayload", true );
+      test_should_be( buffer.headroom(), size_t { 0 } );
+    }
+
+    // Shared storage can't be written in place, and isn't disturbed by giving up headroom
+    {
+      Buffer buffer = Buffer::with_headroom( "payload", 4 );
+      test_should_be( buffer.can_prepend( 4 ), true );
+      const Buffer copy = buffer;
+      test_should_be( buffer.can_prepend( 4 ), false );
+
+      bool threw = false;
+      try {
+        buffer.prepend( 4 );
+      } catch ( const runtime_error& ) {
+        threw = true;
+      }
+      test_should_be( threw, true );
+
+      string& str = buffer;
+      str += "!";
+      test_should_be( string_view { buffer } == "payload!", true );
+      test_should_be( string_view { copy } == "payload", true );
+    }
+
+    // A datagram parsed from one contiguous Buffer is serialized again in place, with the same
+    // bytes as a serialization by copy
+    {
+      const string original = concatenate( serialize( make_datagram( "some payload" ) ) );
+      vector<Buffer> frame_payload { Buffer { original } };
+      InternetDatagram dgram;
+      test_should_be( parse( dgram, frame_payload ), true );
+      frame_payload.clear();
+      test_should_be( dgram.payload.size(), size_t { 1 } );
+      test_should_be( dgram.payload.front().headroom(), size_t { IPv4Header::LENGTH } );
+
+      dgram.header.decrement_ttl();
+      const string copied = concatenate( serialize( dgram ) );
+      const vector<Buffer> in_place = serialize( std::move( dgram ) );
+      test_should_be( in_place.size(), size_t { 1 } );
+      test_should_be( concatenate( in_place ) == copied, true );
+      test_should_be( copied.size(), original.size() );
+    }
+
+    // Without headroom, the header goes in a Buffer of its own
+    {
+      InternetDatagram dgram = make_datagram( "some payload" );
+      const string copied = concatenate( serialize( dgram ) );
+      const vector<Buffer> moved = serialize( std::move( dgram ) );
+      test_should_be( moved.size(), size_t { 2 } );
+      test_should_be( concatenate( moved ) == copied, true );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,146 @@
+#include "buffer.hh"
+#include "test_should_be.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+const char* data_of( const Buffer& buffer )
+{
+  return string_view { buffer }.data();
+}
+
+int main()
+{
+  try {
+    // Copies share the storage, and count their references
+    {
+      const Buffer buffer { string( 100, 'x' ) };
+      test_should_be( buffer.use_count(), uint32_t { 1 } );
+      {
+        const Buffer copy = buffer;
+        Buffer assigned;
+        assigned = buffer;
+        test_should_be( buffer.use_count(), uint32_t { 3 } );
+        test_should_be( data_of( copy ) == data_of( buffer ), true );
+      }
+      test_should_be( buffer.use_count(), uint32_t { 1 } );
+
+      Buffer moved = buffer;
+      const Buffer taker = std::move( moved );
+      test_should_be( buffer.use_count(), uint32_t { 2 } );
+    }
+
+    // A Buffer's storage goes back to the pool when the Buffer is gone, and is reused (memory and
+    // all) by the next Buffer of the same size class
+    {
+      const char* storage = nullptr;
+      {
+        const Buffer frame = Buffer::with_headroom( string( 1500, 'f' ), 20 );
+        storage = data_of( frame ) - 20;
+      }
+      const Buffer next = Buffer::with_headroom( string( 1000, 'g' ), 20 );
+      test_should_be( data_of( next ) - 20 == storage, true );
+      test_should_be( string_view { next } == string( 1000, 'g' ), true );
+
+      // ... but a header does not take a node with room for a frame
+      const char* frame_storage = data_of( next ) - 20;
+      const Buffer header = Buffer::with_headroom( "header", 0 );
+      test_should_be( data_of( header ) == frame_storage, false );
+    }
+
+    // A Buffer made from a string takes the string's memory, without copying the bytes
+    {
+      string str( 1200, 's' );
+      const char* string_storage = str.data();
+      const Buffer buffer { std::move( str ) };
+      test_should_be( data_of( buffer ) == string_storage, true );
+      test_should_be( string_view { buffer } == string( 1200, 's' ), true );
+    }
+
+    // An empty Buffer takes no node, and gives one up when it is moved from
+    {
+      const Buffer empty;
+      const Buffer from_string { string {} };
+      test_should_be( empty.use_count(), uint32_t { 0 } );
+      test_should_be( from_string.use_count(), uint32_t { 0 } );
+      test_should_be( empty.size(), size_t { 0 } );
+      test_should_be( string_view { empty }.empty(), true );
+
+      Buffer moved { "bytes" };
+      const Buffer taker = std::move( moved );
+      test_should_be( moved.use_count(), uint32_t { 0 } ); // NOLINT(*-use-after-move)
+      test_should_be( taker.use_count(), uint32_t { 1 } );
+
+      // ... and it can still be copied, assigned and written to
+      const Buffer copy = moved; // NOLINT(*-use-after-move)
+      Buffer assigned { "other" };
+      assigned = moved;
+      test_should_be( copy.empty(), true );
+      test_should_be( assigned.empty(), true );
+      static_cast<string&>( assigned ).append( "written" );
+      test_should_be( string_view { assigned } == "written", true );
+      test_should_be( copy.empty(), true );
+    }
+
+    // Unsharing gives a Buffer storage of its own, keeping its bytes and headroom
+    {
+      Buffer buffer = Buffer::with_headroom( "payload", 20 );
+      const Buffer copy = buffer;
+      buffer.unshare();
+      test_should_be( buffer.use_count(), uint32_t { 1 } );
+      test_should_be( copy.use_count(), uint32_t { 1 } );
+      test_should_be( data_of( buffer ) == data_of( copy ), false );
+      test_should_be( string_view { buffer } == "payload", true );
+      test_should_be( buffer.headroom(), size_t { 20 } );
+      test_should_be( buffer.can_prepend( 20 ), true );
+
+      // An unshared Buffer stays as it is
+      const char* storage = data_of( buffer );
+      buffer.unshare();
+      test_should_be( data_of( buffer ) == storage, true );
+    }
+
+    // A Buffer can be let go of on another thread than the one that made it
+    {
+      vector<Buffer> buffers;
+      for ( size_t i = 0; i < 1000; ++i ) {
+        buffers.emplace_back( string( 200, static_cast<char>( 'a' + i % 26 ) ) );
+      }
+      thread other { [moved = std::move( buffers )]() mutable { moved.clear(); } };
+      other.join();
+    }
+
+    // SharedBuffer copies can be made and let go of on several threads at once
+    {
+      const SharedBuffer shared { string( 100, 's' ) };
+      vector<thread> threads;
+      for ( size_t t = 0; t < 4; ++t ) {
+        threads.emplace_back( [&shared] {
+          for ( size_t i = 0; i < 10'000; ++i ) {
+            const SharedBuffer copy = shared;
+            if ( copy.size() != 100 ) {
+              throw runtime_error( "SharedBuffer copy has the wrong size" );
+            }
+          }
+        } );
+      }
+      for ( auto& t : threads ) {
+        t.join();
+      }
+      test_should_be( shared.use_count(), uint32_t { 1 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
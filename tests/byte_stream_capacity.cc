@@ -97,6 +97,26 @@ int main()
       test.execute( BytesBuffered { 1 } );
     }
 
+    {
+      ByteStreamTestHarness test { "wrap around", 4 };
+
+      test.execute( Push { "abc" } );
+      test.execute( Pop { 2 } );
+      test.execute( Push { "defg" } );
+      test.execute( BytesPushed { 6 } );
+      test.execute( AvailableCapacity { 0 } );
+      test.execute( PeekHalves { "cd", "ef" } );
+      test.execute( PeekOnce { "cd" } );
+      test.execute( Peek { "cdef" } );
+      test.execute( PeekAll { "cdef" } );
+      test.execute( Pop { 3 } );
+      test.execute( PeekHalves { "f", "" } );
+      test.execute( Pop { 1 } );
+      test.execute( PeekHalves { "", "" } );
+      test.execute( Push { "hijk" } );
+      test.execute( PeekHalves { "hijk", "" } );
+    }
+
   } catch ( const exception& e ) {
     cerr << "Exception: " << e.what() << endl;
     return EXIT_FAILURE;
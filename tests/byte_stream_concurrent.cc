@@ -0,0 +1,173 @@
+#include "concurrent_byte_stream.hh"
+#include "test_should_be.hh"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+
+using namespace std;
+using namespace std::chrono_literals;
+
+// Run `wait` on another thread, and check that it blocks until `wake` is called (and not before)
+void test_wakes( const string& what, const function<void()>& wait, const function<void()>& wake )
+{
+  atomic<bool> returned { false };
+  thread waiter { [&] {
+    wait();
+    returned = true;
+  } };
+
+  this_thread::sleep_for( 20ms );
+  if ( returned ) {
+    waiter.join();
+    throw runtime_error( what + ": returned before being woken" );
+  }
+
+  wake();
+  waiter.join();
+  test_should_be( returned.load(), true );
+}
+
+int main()
+{
+  try {
+    // One thread at a time: the same behavior as a ByteStream
+    {
+      ConcurrentByteStream stream { 8 };
+      test_should_be( stream.writer().available_capacity(), uint64_t { 8 } );
+      stream.writer().push( "hello" );
+      stream.writer().push( "world" );
+      test_should_be( stream.writer().bytes_pushed(), uint64_t { 8 } );
+      test_should_be( stream.writer().available_capacity(), uint64_t { 0 } );
+      test_should_be( stream.reader().peek() == "hellowor", true );
+
+      stream.reader().pop( 6 );
+      stream.writer().push( "ld!" );
+      test_should_be( stream.reader().peek_all().size(), size_t { 2 } ); // Wrapped around the ring
+      test_should_be( stream.reader().bytes_buffered(), uint64_t { 5 } );
+      test_should_be( stream.reader().bytes_popped(), uint64_t { 6 } );
+
+      stream.writer().close();
+      test_should_be( stream.writer().is_closed(), true );
+      test_should_be( stream.reader().is_finished(), false );
+      stream.reader().pop( 5 );
+      test_should_be( stream.reader().is_finished(), true );
+      test_should_be( stream.reader().has_error(), false );
+    }
+
+    // Neither side waits when it has no need to
+    {
+      ConcurrentByteStream stream { 4 };
+      stream.writer().wait_writable();
+      stream.writer().push( "abc" );
+      stream.reader().wait_readable();
+      stream.writer().push( "d" );
+      stream.writer().set_error();
+      stream.writer().wait_writable(); // Full, but has an error
+      test_should_be( stream.reader().has_error(), true );
+    }
+    {
+      ConcurrentByteStream stream { 4 };
+      stream.writer().close();
+      stream.reader().wait_readable(); // Empty, but closed
+      test_should_be( stream.reader().is_finished(), true );
+    }
+
+    // wait_readable() wakes up on a push, a close, or an error
+    {
+      ConcurrentByteStream stream { 4 };
+      test_wakes(
+        "wait_readable on push", [&] { stream.reader().wait_readable(); }, [&] { stream.writer().push( "x" ); } );
+      test_should_be( stream.reader().bytes_buffered(), uint64_t { 1 } );
+    }
+    {
+      ConcurrentByteStream stream { 4 };
+      test_wakes(
+        "wait_readable on close", [&] { stream.reader().wait_readable(); }, [&] { stream.writer().close(); } );
+      test_should_be( stream.reader().is_finished(), true );
+    }
+    {
+      ConcurrentByteStream stream { 4 };
+      test_wakes(
+        "wait_readable on error", [&] { stream.reader().wait_readable(); }, [&] { stream.writer().set_error(); } );
+      test_should_be( stream.reader().has_error(), true );
+      test_should_be( stream.reader().is_finished(), false );
+    }
+
+    // wait_writable() wakes up on a pop, or an error
+    {
+      ConcurrentByteStream stream { 4 };
+      stream.writer().push( "full" );
+      test_wakes(
+        "wait_writable on pop", [&] { stream.writer().wait_writable(); }, [&] { stream.reader().pop( 1 ); } );
+      test_should_be( stream.writer().available_capacity(), uint64_t { 1 } );
+    }
+    {
+      ConcurrentByteStream stream { 4 };
+      stream.writer().push( "full" );
+      test_wakes(
+        "wait_writable on error", [&] { stream.writer().wait_writable(); }, [&] { stream.writer().set_error(); } );
+      test_should_be( stream.writer().available_capacity(), uint64_t { 0 } );
+    }
+
+    // A close, after every byte, reaches a reader on another thread
+    {
+      string data;
+      for ( size_t i = 0; i < 100'000; ++i ) {
+        data.push_back( static_cast<char>( 'a' + i % 26 ) );
+      }
+
+      ConcurrentByteStream stream { 64 };
+      thread writer { [&] {
+        for ( size_t i = 0; i < data.size(); ) {
+          stream.writer().wait_writable();
+          const uint64_t before = stream.writer().bytes_pushed();
+          stream.writer().push( data.substr( i, 100 ) );
+          i += stream.writer().bytes_pushed() - before;
+        }
+        stream.writer().close();
+      } };
+
+      string got;
+      while ( not stream.reader().is_finished() ) {
+        stream.reader().wait_readable();
+        for ( const auto view : stream.reader().peek_all() ) {
+          got += view;
+          stream.reader().pop( view.size() );
+        }
+      }
+      writer.join();
+      test_should_be( got == data, true );
+      test_should_be( stream.reader().has_error(), false );
+    }
+
+    // So does an error, which also releases a reader waiting for more
+    {
+      ConcurrentByteStream stream { 64 };
+      thread writer { [&] {
+        stream.writer().push( "partial" );
+        stream.writer().set_error();
+      } };
+
+      uint64_t popped = 0;
+      while ( not stream.reader().has_error() ) {
+        stream.reader().wait_readable();
+        popped += stream.reader().bytes_buffered();
+        stream.reader().pop( stream.reader().bytes_buffered() );
+      }
+      writer.join();
+      test_should_be( popped + stream.reader().bytes_buffered(), uint64_t { 7 } );
+      test_should_be( stream.reader().is_finished(), false );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
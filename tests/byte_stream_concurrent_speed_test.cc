@@ -0,0 +1,130 @@
+#include "concurrent_byte_stream.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <pthread.h>
+#include <queue>
+#include <random>
+#include <sched.h>
+#include <thread>
+
+using namespace std;
+using namespace std::chrono;
+
+// Pin a thread to one core (if the machine has that many), so the two sides stay on separate cores.
+void pin_to_core( thread& t, const unsigned core )
+{
+  if ( core >= thread::hardware_concurrency() ) {
+    return;
+  }
+  cpu_set_t cpus;
+  CPU_ZERO( &cpus );
+  CPU_SET( core, &cpus );
+  pthread_setaffinity_np( t.native_handle(), sizeof( cpus ), &cpus );
+}
+
+void speed_test( const size_t input_len,   // NOLINT(bugprone-easily-swappable-parameters)
+                 const size_t capacity,    // NOLINT(bugprone-easily-swappable-parameters)
+                 const size_t random_seed, // NOLINT(bugprone-easily-swappable-parameters)
+                 const size_t write_size,  // NOLINT(bugprone-easily-swappable-parameters)
+                 const size_t read_size )  // NOLINT(bugprone-easily-swappable-parameters)
+{
+  // Generate the data to be written
+  const string data = [&random_seed, &input_len] {
+    default_random_engine rd { random_seed };
+    uniform_int_distribution<char> ud;
+    string ret;
+    for ( size_t i = 0; i < input_len; ++i ) {
+      ret += ud( rd );
+    }
+    return ret;
+  }();
+
+  // Split the data into segments before writing
+  queue<string> split_data;
+  for ( size_t i = 0; i < data.size(); i += write_size ) {
+    split_data.emplace( data.substr( i, write_size ) );
+  }
+
+  ConcurrentByteStream bs { capacity };
+  string output_data;
+  output_data.reserve( data.size() );
+
+  const auto start_time = steady_clock::now();
+
+  thread writer { [&] {
+    auto& w = bs.writer();
+    while ( not split_data.empty() ) {
+      string& next = split_data.front();
+      w.wait_writable();
+      const uint64_t len = min( static_cast<uint64_t>( next.size() ), w.available_capacity() );
+      w.push( next.substr( 0, len ) );
+      next.erase( 0, len );
+      if ( next.empty() ) {
+        split_data.pop();
+      }
+    }
+    w.close();
+  } };
+
+  thread reader { [&] {
+    auto& r = bs.reader();
+    while ( not r.is_finished() ) {
+      r.wait_readable();
+      auto peeked = r.peek().substr( 0, read_size );
+      output_data += peeked;
+      r.pop( peeked.size() );
+    }
+  } };
+
+  pin_to_core( writer, 0 );
+  pin_to_core( reader, 1 );
+
+  writer.join();
+  reader.join();
+
+  const auto stop_time = steady_clock::now();
+
+  if ( data != output_data ) {
+    throw runtime_error( "Mismatch between data written and read" );
+  }
+
+  auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  auto bytes_per_second = static_cast<double>( input_len ) / test_duration.count();
+  auto gigabytes_per_second = bytes_per_second / 1e9;
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "ConcurrentByteStream with capacity=" << capacity << ", write_size=" << write_size
+       << ", read_size=" << read_size << " reached " << fixed << setprecision( 2 ) << gigabytes_per_second
+       << " GB/s.\n";
+
+  debug_output << "             ConcurrentByteStream throughput: " << fixed << setprecision( 2 )
+               << gigabytes_per_second << " GB/s\n";
+
+  if ( gigabytes_per_second < 0.0125 ) {
+    throw runtime_error( "ConcurrentByteStream did not meet minimum speed of 0.0125 GB/s." );
+  }
+}
+
+void program_body()
+{
+  speed_test( 1e8, 32768, 789, 1500, 4096 );
+  speed_test( 1e8, 1048576, 789, 65536, 65536 );
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
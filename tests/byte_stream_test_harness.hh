@@ -16,8 +16,13 @@ static_assert( sizeof( Writer ) == sizeof( ByteStream ),
 class ByteStreamTestHarness : public TestHarness<ByteStream>
 {
 public:
-  ByteStreamTestHarness( std::string test_name, uint64_t capacity )
-    : TestHarness( move( test_name ), "capacity=" + std::to_string( capacity ), ByteStream { capacity } )
+  ByteStreamTestHarness( std::string test_name,
+                         uint64_t capacity,
+                         ByteStream::Storage storage = ByteStream::Storage::Ring )
+    : TestHarness( move( test_name ),
+                   "capacity=" + std::to_string( capacity )
+                     + ( storage == ByteStream::Storage::Chunks ? ", storage=chunks" : "" ),
+                   ByteStream { capacity, storage } )
   {}
 
   size_t peek_size() { return object().reader().peek().size(); }
@@ -107,6 +112,56 @@ struct PeekOnce : public Peek
   }
 };
 
+struct PeekHalves : public Expectation<ByteStream>
+{
+  std::string first_;
+  std::string second_;
+
+  PeekHalves( std::string first, std::string second ) : first_( move( first ) ), second_( move( second ) ) {}
+
+  std::string description() const override
+  {
+    return "peek_halves() gives \"" + Printer::prettify( first_ ) + "\" and \"" + Printer::prettify( second_ )
+           + "\"";
+  }
+
+  void execute( ByteStream& bs ) const override
+  {
+    const auto [first, second] = bs.reader().peek_halves();
+    if ( first != first_ or second != second_ ) {
+      throw ExpectationViolation { "Expected \"" + Printer::prettify( first_ ) + "\" and \""
+                                   + Printer::prettify( second_ ) + "\", but found \"" + Printer::prettify( first )
+                                   + "\" and \"" + Printer::prettify( second ) + "\"" };
+    }
+  }
+};
+
+struct PeekAll : public Peek
+{
+  using Peek::Peek;
+
+  std::string description() const override
+  {
+    return "peek_all() gives \"" + Printer::prettify( output_ ) + "\"";
+  }
+
+  void execute( ByteStream& bs ) const override
+  {
+    std::string got;
+    for ( const auto view : bs.reader().peek_all() ) {
+      if ( view.empty() ) {
+        throw ExpectationViolation { "Reader::peek_all() returned an empty string_view" };
+      }
+      got += view;
+    }
+
+    if ( got != output_ ) {
+      throw ExpectationViolation { "Expected \"" + Printer::prettify( output_ ) + "\" in buffer, "
+                                   + " but found \"" + Printer::prettify( got ) + "\"" };
+    }
+  }
+};
+
 struct IsClosed : public ExpectBool<ByteStream>
 {
   using ExpectBool::ExpectBool;
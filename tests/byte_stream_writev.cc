@@ -0,0 +1,141 @@
+#include "byte_stream.hh"
+#include "exception.hh"
+#include "file_descriptor.hh"
+#include "test_should_be.hh"
+
+#include <cstdint>
+#include <exception>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <utility>
+
+using namespace std;
+
+// A pipe whose write end doesn't block, so that a write can be cut short by a full pipe
+pair<FileDescriptor, FileDescriptor> make_pipe()
+{
+  int fds[2] {};
+  if ( ::pipe2( fds, O_NONBLOCK ) != 0 ) { // NOLINT(*-array-to-pointer-decay)
+    throw unix_error { "pipe2" };
+  }
+  FileDescriptor read_end { fds[0] };
+  FileDescriptor write_end { fds[1] };
+  read_end.set_blocking( true );
+  return { std::move( read_end ), std::move( write_end ) };
+}
+
+// Read exactly `len` bytes from the pipe
+string read_exactly( FileDescriptor& fd, uint64_t len )
+{
+  string got;
+  string chunk;
+  while ( got.size() < len ) {
+    fd.read( chunk );
+    if ( chunk.empty() ) {
+      throw runtime_error( "pipe closed early" );
+    }
+    got += chunk;
+  }
+  test_should_be( got.size(), static_cast<size_t>( len ) );
+  return got;
+}
+
+string pattern( size_t len, size_t start )
+{
+  string str;
+  for ( size_t i = start; i < start + len; ++i ) {
+    str.push_back( static_cast<char>( 'a' + i % 26 ) );
+  }
+  return str;
+}
+
+void test_storage( ByteStream::Storage storage )
+{
+  // Nothing buffered, nothing written
+  {
+    auto [in, out] = make_pipe();
+    ByteStream stream { 16, storage };
+    test_should_be( write( stream.reader(), out ), uint64_t { 0 } );
+    test_should_be( out.write_count(), 0U );
+  }
+
+  // Every piece goes out in one writev(2)
+  {
+    auto [in, out] = make_pipe();
+    ByteStream stream { 64, storage };
+    stream.writer().push( "hello" );
+    stream.writer().push( ", " );
+    stream.writer().push( "world" );
+    test_should_be( write( stream.reader(), out ), uint64_t { 12 } );
+    test_should_be( out.write_count(), 1U );
+    test_should_be( stream.reader().bytes_buffered(), uint64_t { 0 } );
+    test_should_be( stream.reader().bytes_popped(), uint64_t { 12 } );
+    test_should_be( read_exactly( in, 12 ) == "hello, world", true );
+  }
+
+  // Bytes that wrap around the end of the ring (or span several chunks) go out in order
+  {
+    auto [in, out] = make_pipe();
+    ByteStream stream { 16, storage };
+    stream.writer().push( pattern( 12, 0 ) );
+    string discarded;
+    read( stream.reader(), 10, discarded );
+    stream.writer().push( pattern( 10, 12 ) );
+    test_should_be( stream.reader().peek_all().size(), size_t { 2 } );
+    test_should_be( write( stream.reader(), out ), uint64_t { 12 } );
+    test_should_be( read_exactly( in, 12 ) == pattern( 12, 10 ), true );
+    test_should_be( stream.reader().bytes_buffered(), uint64_t { 0 } );
+  }
+
+  // A write cut short by a full pipe pops only the bytes the kernel accepted
+  {
+    auto [in, out] = make_pipe();
+    const int pipe_size = ::fcntl( out.fd_num(), F_SETPIPE_SZ, 4096 ); // NOLINT(*-vararg)
+    if ( pipe_size <= 0 ) {
+      throw unix_error { "fcntl(F_SETPIPE_SZ)" };
+    }
+    const uint64_t total = 4 * static_cast<uint64_t>( pipe_size );
+
+    ByteStream stream { total, storage };
+    stream.writer().push( pattern( total / 2, 0 ) );
+    string discarded;
+    read( stream.reader(), total / 4, discarded );
+    stream.writer().push( pattern( total / 2, total / 2 ) );
+    stream.writer().push( pattern( total / 4, total ) ); // Wraps around the ring
+    test_should_be( stream.reader().bytes_buffered(), total );
+    const size_t pieces = storage == ByteStream::Storage::Ring ? 2 : 3;
+    test_should_be( stream.reader().peek_all().size(), pieces );
+
+    const uint64_t written = write( stream.reader(), out );
+    if ( written == 0 or written >= total ) {
+      throw runtime_error( "expected a partial write, but wrote " + to_string( written ) );
+    }
+    test_should_be( stream.reader().bytes_popped(), total / 4 + written );
+    test_should_be( stream.reader().bytes_buffered(), total - written );
+    test_should_be( read_exactly( in, written ) == pattern( written, total / 4 ), true );
+
+    // ... and the rest follows, in order, once the pipe has room again
+    uint64_t sent = total / 4 + written;
+    while ( stream.reader().bytes_buffered() > 0 ) {
+      const uint64_t more = write( stream.reader(), out );
+      test_should_be( read_exactly( in, more ) == pattern( more, sent ), true );
+      sent += more;
+    }
+    test_should_be( sent, total + total / 4 );
+  }
+}
+
+int main()
+{
+  try {
+    test_storage( ByteStream::Storage::Ring );
+    test_storage( ByteStream::Storage::Chunks );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,117 @@
+#include "checksum.hh"
+#include "random.hh"
+#include "test_should_be.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// The internet checksum computed one byte at a time, straight from the definition.
+uint16_t reference_checksum( const string& data )
+{
+  uint64_t sum = 0;
+  for ( size_t i = 0; i < data.size(); i++ ) {
+    const uint16_t byte = static_cast<uint8_t>( data[i] );
+    sum += i % 2 ? byte : byte << 8;
+  }
+  while ( sum > 0xffff ) {
+    sum = ( sum >> 16 ) + ( sum & 0xffff );
+  }
+  return ~static_cast<uint16_t>( sum );
+}
+
+string random_string( default_random_engine& rd, const size_t len )
+{
+  uniform_int_distribution<char> ud;
+  string ret;
+  for ( size_t i = 0; i < len; i++ ) {
+    ret += ud( rd );
+  }
+  return ret;
+}
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    // A worked example: an IPv4 header with its checksum field zeroed
+    {
+      const string header {
+        "\x45\x00\x00\x73\x00\x00\x40\x00\x40\x11\x00\x00\xc0\xa8\x00\x01\xc0\xa8\x00\xc7", 20 };
+      InternetChecksum check;
+      check.add( header );
+      test_should_be( check.value(), static_cast<uint16_t>( 0xb861 ) );
+    }
+
+    // Whole strings of every length up to a few vector widths, and some long ones
+    for ( size_t len = 0; len < 300; len++ ) {
+      const string data = random_string( rd, len );
+      InternetChecksum check;
+      check.add( data );
+      test_should_be( check.value(), reference_checksum( data ) );
+    }
+    for ( const size_t len : { 65535UL, 65536UL, 1048577UL } ) {
+      const string data = random_string( rd, len );
+      InternetChecksum check;
+      check.add( data );
+      test_should_be( check.value(), reference_checksum( data ) );
+    }
+
+    // The same data split into chunks of arbitrary (often odd) length, including a list of Buffers
+    for ( size_t rep = 0; rep < 1000; rep++ ) {
+      const string data = random_string( rd, uniform_int_distribution<size_t> { 0, 2000 }( rd ) );
+      vector<Buffer> chunks;
+      for ( size_t i = 0; i < data.size(); ) {
+        const size_t len = uniform_int_distribution<size_t> { 0, 80 }( rd );
+        chunks.emplace_back( data.substr( i, len ) );
+        i += len;
+      }
+
+      InternetChecksum by_view;
+      for ( const auto& chunk : chunks ) {
+        by_view.add( chunk );
+      }
+      test_should_be( by_view.value(), reference_checksum( data ) );
+
+      InternetChecksum by_buffers;
+      by_buffers.add( chunks );
+      test_should_be( by_buffers.value(), reference_checksum( data ) );
+    }
+
+    // Incremental updates after one 16-bit word or one 32-bit field changes
+    for ( size_t rep = 0; rep < 10000; rep++ ) {
+      string data = random_string( rd, 20 );
+      const uint16_t before = reference_checksum( data );
+
+      const size_t word = uniform_int_distribution<size_t> { 0, 9 }( rd );
+      const uint16_t old_word
+        = static_cast<uint8_t>( data[2 * word] ) << 8 | static_cast<uint8_t>( data[2 * word + 1] );
+      const uint16_t new_word = rd();
+      data[2 * word] = static_cast<char>( new_word >> 8 );
+      data[2 * word + 1] = static_cast<char>( new_word );
+      const uint16_t after_word = reference_checksum( data );
+      test_should_be( InternetChecksum::update( before, old_word, new_word ), after_word );
+
+      const size_t field = uniform_int_distribution<size_t> { 0, 4 }( rd );
+      uint32_t old_field = 0;
+      for ( size_t i = 0; i < 4; i++ ) {
+        old_field = old_field << 8 | static_cast<uint8_t>( data[4 * field + i] );
+      }
+      const uint32_t new_field = rd();
+      for ( size_t i = 0; i < 4; i++ ) {
+        data[4 * field + i] = static_cast<char>( new_field >> ( 24 - 8 * i ) );
+      }
+      test_should_be( InternetChecksum::update( after_word, old_field, new_field ), reference_checksum( data ) );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,112 @@
+#include "forwarding_table.hh"
+#include "random.hh"
+#include "test_should_be.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <span>
+#include <vector>
+
+using namespace std;
+
+// The interface of the longest-prefix match (or -1 if none), found the slow way: try every prefix
+// length, longest first.
+int64_t reference_lookup( const RoutingTable& routing_table, const uint32_t address )
+{
+  for ( int prefix_length = 32; prefix_length >= 0; --prefix_length ) {
+    const auto& routes = routing_table.at( prefix_length );
+    const auto it = routes.find( prefix_of( address, prefix_length ) );
+    if ( it != routes.end() ) {
+      return static_cast<int64_t>( it->second.interface_num );
+    }
+  }
+  return -1;
+}
+
+int64_t interface_num( const Route* route )
+{
+  return route ? static_cast<int64_t>( route->interface_num ) : -1;
+}
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    // An empty table matches nothing
+    {
+      const ForwardingTable empty;
+      test_should_be( interface_num( empty.lookup( 0 ) ), int64_t { -1 } );
+      test_should_be( interface_num( empty.lookup( UINT32_MAX ) ), int64_t { -1 } );
+    }
+
+    // Prefixes at the boundaries between the table's levels
+    {
+      RoutingTable routing_table;
+      routing_table.at( 0 ).insert_or_assign( 0, Route { {}, 0 } );
+      routing_table.at( 16 ).insert_or_assign( 0x0a000000, Route { {}, 16 } );
+      routing_table.at( 17 ).insert_or_assign( 0x0a008000, Route { {}, 17 } );
+      routing_table.at( 24 ).insert_or_assign( 0x0a008100, Route { {}, 24 } );
+      routing_table.at( 25 ).insert_or_assign( 0x0a008180, Route { {}, 25 } );
+      routing_table.at( 32 ).insert_or_assign( 0x0a0081ff, Route { {}, 32 } );
+      const ForwardingTable table { routing_table };
+
+      test_should_be( interface_num( table.lookup( 0x01020304 ) ), int64_t { 0 } );
+      test_should_be( interface_num( table.lookup( 0x0a000001 ) ), int64_t { 16 } );
+      test_should_be( interface_num( table.lookup( 0x0a008001 ) ), int64_t { 17 } );
+      test_should_be( interface_num( table.lookup( 0x0a008101 ) ), int64_t { 24 } );
+      test_should_be( interface_num( table.lookup( 0x0a008181 ) ), int64_t { 25 } );
+      test_should_be( interface_num( table.lookup( 0x0a0081fe ) ), int64_t { 25 } );
+      test_should_be( interface_num( table.lookup( 0x0a0081ff ) ), int64_t { 32 } );
+      test_should_be( interface_num( table.lookup( 0x0a010000 ) ), int64_t { 0 } );
+    }
+
+    // Many overlapping random routes, clustered around a few addresses so that they nest deeply
+    for ( size_t rep = 0; rep < 10; rep++ ) {
+      vector<uint32_t> clusters;
+      for ( size_t i = 0; i < 8; i++ ) {
+        clusters.push_back( rd() );
+      }
+      const auto near_cluster = [&] {
+        const uint32_t noise = rd() & ( ( uint32_t { 1 } << uniform_int_distribution<int> { 0, 31 }( rd ) ) - 1 );
+        return clusters.at( uniform_int_distribution<size_t> { 0, clusters.size() - 1 }( rd ) ) ^ noise;
+      };
+
+      RoutingTable routing_table;
+      for ( size_t i = 0; i < 2000; i++ ) {
+        const auto prefix_length = static_cast<uint8_t>( uniform_int_distribution<int> { 0, 32 }( rd ) );
+        const uint32_t prefix = prefix_of( near_cluster(), prefix_length );
+        routing_table.at( prefix_length ).insert_or_assign( prefix, Route { {}, static_cast<uint32_t>( i ) } );
+      }
+      const ForwardingTable table { routing_table };
+
+      vector<uint32_t> addresses;
+      for ( size_t i = 0; i < 5000; i++ ) {
+        addresses.push_back( i % 2 ? near_cluster() : static_cast<uint32_t>( rd() ) );
+      }
+
+      for ( const uint32_t address : addresses ) {
+        test_should_be( interface_num( table.lookup( address ) ), reference_lookup( routing_table, address ) );
+      }
+
+      // The same lookups done in batches of assorted sizes
+      vector<const Route*> routes( addresses.size() );
+      for ( size_t first = 0; first < addresses.size(); ) {
+        const size_t len = min( uniform_int_distribution<size_t> { 0, 200 }( rd ), addresses.size() - first );
+        table.lookup( span { addresses }.subspan( first, len ), span { routes }.subspan( first, len ) );
+        first += len;
+      }
+      for ( size_t i = 0; i < addresses.size(); i++ ) {
+        test_should_be( interface_num( routes[i] ), reference_lookup( routing_table, addresses[i] ) );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
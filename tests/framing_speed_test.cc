@@ -0,0 +1,275 @@
+#include "arp_message.hh"
+#include "ethernet_frame.hh"
+#include "ipv4_datagram.hh"
+#include "network_interface.hh"
+#include "parser.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+// Every allocation made by the program, to count those made per frame
+namespace {
+size_t allocations = 0;
+} // namespace
+
+void* operator new( size_t size )
+{
+  ++allocations;
+  if ( void* p = malloc( size ) ) {
+    return p;
+  }
+  throw bad_alloc {};
+}
+
+void operator delete( void* p ) noexcept
+{
+  free( p );
+}
+
+void operator delete( void* p, size_t /* size */ ) noexcept
+{
+  free( p );
+}
+
+namespace {
+
+constexpr size_t NUM_FRAMES = 200'000;
+constexpr size_t PAYLOAD_SIZE = 1000;
+
+const EthernetAddress ROUTER_ETHERNET { 0x02, 0, 0, 0, 0, 1 };
+const EthernetAddress NEXT_HOP_ETHERNET { 0x02, 0, 0, 0, 0, 2 };
+const Address ROUTER_IP { "10.0.0.1", 0 };
+const Address NEXT_HOP_IP { "10.0.0.2", 0 };
+
+// Frames carrying IPv4 datagrams to the router, each payload in one contiguous Buffer, as read from a device
+vector<EthernetFrame> make_frames()
+{
+  vector<EthernetFrame> frames( NUM_FRAMES );
+  for ( size_t i = 0; i < frames.size(); ++i ) {
+    InternetDatagram dgram;
+    dgram.header.proto = 17;
+    dgram.header.src = 0x0a010000 | static_cast<uint32_t>( i & 0xffff );
+    dgram.header.dst = 0x0a020000 | static_cast<uint32_t>( i & 0xffff );
+    dgram.header.len = static_cast<uint16_t>( dgram.header.hlen * 4 + PAYLOAD_SIZE );
+    dgram.header.ttl = 64;
+    dgram.header.compute_checksum();
+    dgram.payload.emplace_back( string( PAYLOAD_SIZE, static_cast<char>( 'a' + i % 26 ) ) );
+
+    string bytes;
+    for ( const auto& buffer : serialize( dgram ) ) {
+      bytes += string_view { buffer };
+    }
+    frames[i].header.dst = ROUTER_ETHERNET;
+    frames[i].header.src = NEXT_HOP_ETHERNET;
+    frames[i].header.type = EthernetHeader::TYPE_IPv4;
+    frames[i].payload.emplace_back( std::move( bytes ) );
+  }
+  return frames;
+}
+
+string concatenate( const vector<Buffer>& buffers )
+{
+  string bytes;
+  for ( const auto& buffer : buffers ) {
+    bytes += string_view { buffer };
+  }
+  return bytes;
+}
+
+// What a path through the code cost, over all the frames
+struct Costs
+{
+  size_t allocations {};
+  uint64_t buffer_copies {}; // Each of which takes a reference to shared storage
+};
+
+// Measures the costs from construction to finish()
+class Meter
+{
+  size_t allocations_before_ { allocations };
+  uint64_t buffer_copies_before_ { Buffer::copies() };
+  steady_clock::time_point start_time_ { steady_clock::now() };
+
+public:
+  Costs finish( const string& path ) const
+  {
+    const auto elapsed = steady_clock::now() - start_time_;
+    const Costs costs { allocations - allocations_before_, Buffer::copies() - buffer_copies_before_ };
+
+    const auto per_frame = []( const double total ) { return total / static_cast<double>( NUM_FRAMES ); };
+    cout << left << setw( 48 ) << path + ":" << right << fixed << setprecision( 2 ) << setw( 6 )
+         << per_frame( static_cast<double>( costs.allocations ) ) << " allocations/frame, " << setw( 6 )
+         << per_frame( static_cast<double>( costs.buffer_copies ) ) << " Buffer copies/frame, " << setw( 7 )
+         << per_frame( static_cast<double>( duration_cast<nanoseconds>( elapsed ).count() ) ) << " ns/frame\n";
+    return costs;
+  }
+};
+
+// Parse each frame's datagram, decrement its TTL, and serialize it again, by copy or (taking over
+// the frame's payload) in place.
+Costs forward_test( const string& path, vector<EthernetFrame> frames, const bool in_place )
+{
+  size_t bytes = 0;
+  const Meter meter;
+  for ( auto& frame : frames ) {
+    InternetDatagram dgram;
+    const bool parsed = in_place ? parse( dgram, std::move( frame.payload ) ) : parse( dgram, frame.payload );
+    if ( not parsed ) {
+      throw runtime_error( "framing_speed_test: could not parse datagram" );
+    }
+    frame.payload.clear(); // As when a device hands over the frame
+    dgram.header.decrement_ttl();
+    const vector<Buffer> out = in_place ? serialize( std::move( dgram ) ) : serialize( dgram );
+    for ( const auto& buffer : out ) {
+      bytes += buffer.size();
+    }
+  }
+  const Costs costs = meter.finish( path );
+
+  if ( bytes != NUM_FRAMES * ( IPv4Header::LENGTH + PAYLOAD_SIZE ) ) {
+    throw runtime_error( "framing_speed_test: wrong number of bytes serialized" );
+  }
+  return costs;
+}
+
+// Parse the Ethernet and IPv4 headers of each frame, read off the wire as one contiguous Buffer
+Costs parse_test( const string& path, const vector<EthernetFrame>& frames )
+{
+  vector<vector<Buffer>> wire;
+  wire.reserve( frames.size() );
+  for ( const auto& frame : frames ) {
+    wire.push_back( { concatenate( serialize( frame ) ) } );
+  }
+
+  uint64_t checksum = 0;
+  const Meter meter;
+  for ( auto& bytes : wire ) {
+    EthernetFrame frame;
+    InternetDatagram dgram;
+    if ( not parse( frame, std::move( bytes ) ) or not parse( dgram, std::move( frame.payload ) ) ) {
+      throw runtime_error( "framing_speed_test: could not parse frame" );
+    }
+    checksum += frame.header.type + dgram.header.dst + dgram.header.cksum;
+  }
+  const Costs costs = meter.finish( path );
+
+  if ( checksum == 0 ) {
+    throw runtime_error( "framing_speed_test: parsed nothing" );
+  }
+  return costs;
+}
+
+// Receive each frame on a NetworkInterface and send its datagram back out, passing frames and
+// datagrams by const reference or by rvalue
+Costs interface_test( const string& path, vector<EthernetFrame> frames, const bool by_rvalue )
+{
+  NetworkInterface interface { ROUTER_ETHERNET, ROUTER_IP };
+
+  // Learn the next hop's Ethernet address from its ARP request
+  ARPMessage request;
+  request.opcode = ARPMessage::OPCODE_REQUEST;
+  request.sender_ethernet_address = NEXT_HOP_ETHERNET;
+  request.sender_ip_address = NEXT_HOP_IP.ipv4_numeric();
+  request.target_ip_address = ROUTER_IP.ipv4_numeric();
+  EthernetFrame arp_frame;
+  arp_frame.header.dst = ETHERNET_BROADCAST;
+  arp_frame.header.src = NEXT_HOP_ETHERNET;
+  arp_frame.header.type = EthernetHeader::TYPE_ARP;
+  arp_frame.payload = serialize( request );
+  interface.recv_frame( arp_frame );
+  while ( interface.maybe_send().has_value() ) {}
+
+  size_t sent = 0;
+  const uint32_t next_hop = NEXT_HOP_IP.ipv4_numeric();
+  const Meter meter;
+  for ( auto& frame : frames ) {
+    optional<InternetDatagram> dgram;
+    if ( by_rvalue ) {
+      dgram = interface.recv_frame( std::move( frame ) );
+    } else {
+      dgram = interface.recv_frame( frame );
+      frame.payload.clear();
+    }
+    if ( not dgram.has_value() ) {
+      throw runtime_error( "framing_speed_test: NetworkInterface did not receive datagram" );
+    }
+    dgram->header.decrement_ttl();
+    const auto result = by_rvalue ? interface.send_datagram( std::move( *dgram ), next_hop )
+                                  : interface.send_datagram( *dgram, next_hop );
+    sent += result == NetworkInterface::SendResult::Sent and interface.maybe_send().has_value();
+  }
+  const Costs costs = meter.finish( path );
+
+  if ( sent != NUM_FRAMES ) {
+    throw runtime_error( "framing_speed_test: NetworkInterface did not send every datagram" );
+  }
+  return costs;
+}
+
+// Both ways of serializing a forwarded datagram give the same bytes
+void check( const vector<EthernetFrame>& frames )
+{
+  for ( size_t i = 0; i < 100; ++i ) {
+    EthernetFrame frame { frames[i].header, { concatenate( frames[i].payload ) } };
+    InternetDatagram dgram;
+    if ( not parse( dgram, frame.payload ) ) {
+      throw runtime_error( "framing_speed_test: could not parse datagram" );
+    }
+    frame.payload.clear();
+    dgram.header.decrement_ttl();
+    const string copied = concatenate( serialize( dgram ) );
+    const vector<Buffer> in_place = serialize( std::move( dgram ) );
+    if ( in_place.size() != 1 ) {
+      throw runtime_error( "framing_speed_test: header was not written in place" );
+    }
+    if ( concatenate( in_place ) != copied ) {
+      throw runtime_error( "framing_speed_test: in-place serialization does not match copy" );
+    }
+  }
+}
+
+void program_body()
+{
+  const vector<EthernetFrame> frames = make_frames();
+  check( frames );
+
+  parse_test( "parse Ethernet and IPv4 headers", frames );
+
+  const Costs copied = forward_test( "parse, decrement TTL, serialize (copy)", frames, false );
+  const Costs in_place = forward_test( "parse, decrement TTL, serialize (in place)", frames, true );
+  const Costs by_reference = interface_test( "NetworkInterface receive and send (const&)", frames, false );
+  const Costs by_rvalue = interface_test( "NetworkInterface receive and send (&&)", frames, true );
+
+  if ( in_place.allocations >= copied.allocations or by_rvalue.allocations >= by_reference.allocations ) {
+    throw runtime_error( "framing_speed_test: in-place framing did not save allocations" );
+  }
+  if ( in_place.buffer_copies != 0 or by_rvalue.buffer_copies != 0 ) {
+    throw runtime_error( "framing_speed_test: move-only path copied a Buffer" );
+  }
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -320,6 +320,236 @@ int main()
         serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "10.0.0.1", {}, "10.0.0.5" ) ) ) } );
       test.execute( ExpectNoFrame {} );
     }
+
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      NetworkInterfaceTestHarness test {
+        "datagrams are dropped when their ARP request times out", local_eth, Address( "1.2.3.4", 0 ) };
+
+      test.execute( SendDatagram { make_datagram( "5.6.7.8", "13.12.11.10" ), Address( "10.0.0.1", 0 ) } );
+      test.execute( ExpectFrame {
+        make_frame( local_eth,
+                    ETHERNET_BROADCAST,
+                    EthernetHeader::TYPE_ARP,
+                    serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "1.2.3.4", {}, "10.0.0.1" ) ) ) } );
+      test.execute( SendDatagram { make_datagram( "5.6.7.8", "13.12.11.11" ), Address( "10.0.0.1", 0 ) } );
+      test.execute( ExpectNoFrame {} );
+      test.execute( ExpectArpEntries { 1 } );
+      test.execute( Tick { 5000 } );
+      test.execute( ExpectDatagramsTimedOut { 0 } );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectDatagramsTimedOut { 2 } );
+      test.execute( ExpectArpEntries { 0 } );
+
+      // A late reply is learned, but the dropped datagrams are not sent
+      const EthernetAddress remote_eth = random_private_ethernet_address();
+      test.execute( ReceiveFrame {
+        make_frame(
+          remote_eth,
+          local_eth,
+          EthernetHeader::TYPE_ARP, // NOLINTNEXTLINE(*-suspicious-*)
+          serialize( make_arp( ARPMessage::OPCODE_REPLY, remote_eth, "10.0.0.1", local_eth, "1.2.3.4" ) ) ),
+        {} } );
+      test.execute( ExpectNoFrame {} );
+      test.execute( ExpectArpEntries { 1 } );
+    }
+
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      NetworkInterfaceTestHarness test {
+        "a datagram queued late in a request gets a new request", local_eth, Address( "1.2.3.4", 0 ) };
+      const auto arp_request = make_frame(
+        local_eth,
+        ETHERNET_BROADCAST,
+        EthernetHeader::TYPE_ARP,
+        serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "1.2.3.4", {}, "10.0.0.1" ) ) );
+
+      test.execute( SendDatagram { make_datagram( "5.6.7.8", "13.12.11.10" ), Address( "10.0.0.1", 0 ) } );
+      test.execute( ExpectFrame { arp_request } );
+      test.execute( Tick { 4990 } );
+      const auto datagram = make_datagram( "5.6.7.8", "13.12.11.11" );
+      test.execute( SendDatagram { datagram, Address( "10.0.0.1", 0 ), NetworkInterface::SendResult::Queued } );
+      test.execute( ExpectNoFrame {} );
+
+      // The first datagram has waited its five seconds, but the second one has a new request sent for it
+      test.execute( Tick { 11 } );
+      test.execute( ExpectDatagramsTimedOut { 1 } );
+      test.execute( ExpectFrame { arp_request } );
+      test.execute( ExpectNoFrame {} );
+
+      // ... and is sent when the reply comes
+      test.execute( Tick { 3000 } );
+      const EthernetAddress remote_eth = random_private_ethernet_address();
+      test.execute( ReceiveFrame {
+        make_frame(
+          remote_eth,
+          local_eth,
+          EthernetHeader::TYPE_ARP, // NOLINTNEXTLINE(*-suspicious-*)
+          serialize( make_arp( ARPMessage::OPCODE_REPLY, remote_eth, "10.0.0.1", local_eth, "1.2.3.4" ) ) ),
+        {} } );
+      test.execute(
+        ExpectFrame { make_frame( local_eth, remote_eth, EthernetHeader::TYPE_IPv4, serialize( datagram ) ) } );
+      test.execute( ExpectNoFrame {} );
+      test.execute( ExpectDatagramsTimedOut { 1 } );
+    }
+
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      NetworkInterfaceTestHarness test {
+        "a datagram queued late in a request waits five seconds", local_eth, Address( "1.2.3.4", 0 ) };
+      const auto arp_request = make_frame(
+        local_eth,
+        ETHERNET_BROADCAST,
+        EthernetHeader::TYPE_ARP,
+        serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "1.2.3.4", {}, "10.0.0.1" ) ) );
+
+      test.execute( SendDatagram { make_datagram( "5.6.7.8", "13.12.11.10" ), Address( "10.0.0.1", 0 ) } );
+      test.execute( ExpectFrame { arp_request } );
+      test.execute( Tick { 4990 } );
+      test.execute( SendDatagram { make_datagram( "5.6.7.8", "13.12.11.11" ), Address( "10.0.0.1", 0 ) } );
+      test.execute( Tick { 11 } );
+      test.execute( ExpectDatagramsTimedOut { 1 } );
+      test.execute( ExpectFrame { arp_request } );
+
+      // With no reply, it gives up five seconds after it was queued (before the new request times out)
+      test.execute( Tick { 4989 } );
+      test.execute( ExpectDatagramsTimedOut { 1 } );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectDatagramsTimedOut { 2 } );
+      test.execute( ExpectArpEntries { 1 } );
+
+      // The request it was waiting on runs its course, and no more are sent for it
+      test.execute( Tick { 20 } );
+      test.execute( ExpectNoFrame {} );
+      test.execute( ExpectArpEntries { 0 } );
+    }
+
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      NetworkInterfaceTestHarness test {
+        "ARP state is freed once mappings expire", local_eth, Address( "10.0.0.1", 0 ) };
+
+      // Learn many mappings from ARP requests, at different times
+      for ( uint8_t host = 2; host < 202; ++host ) {
+        const EthernetAddress remote_eth = random_private_ethernet_address();
+        const string remote_ip = "10.0.0." + to_string( host );
+        test.execute( ReceiveFrame {
+          make_frame( remote_eth,
+                      ETHERNET_BROADCAST,
+                      EthernetHeader::TYPE_ARP,
+                      serialize( make_arp( ARPMessage::OPCODE_REQUEST, remote_eth, remote_ip, {}, "10.0.0.1" ) ) ),
+          {} } );
+        test.execute( ExpectFrame { make_frame(
+          local_eth,
+          remote_eth,
+          EthernetHeader::TYPE_ARP,
+          serialize( make_arp( ARPMessage::OPCODE_REPLY, local_eth, "10.0.0.1", remote_eth, remote_ip ) ) ) } );
+        test.execute( Tick { 100 } );
+      }
+      test.execute( ExpectArpEntries { 200 } );
+
+      // The first hundred (learned up to 10 s ago) expire...
+      test.execute( Tick { 30000 - 100 * 100 } );
+      test.execute( ExpectArpEntries { 100 } );
+
+      // ... and then the rest
+      test.execute( Tick { 100 * 100 } );
+      test.execute( ExpectArpEntries { 0 } );
+    }
+
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      NetworkInterfaceTestHarness test {
+        "datagrams waiting for ARP are capped, dropping the newest", local_eth, Address( "1.2.3.4", 0 ) };
+      test.execute( SetLimits { { 2, 1000, 3, 1000, NetworkInterface::DropPolicy::Newest } } );
+
+      const auto datagram1 = make_datagram( "5.6.7.8", "13.12.11.1" );
+      const auto datagram2 = make_datagram( "5.6.7.8", "13.12.11.2" );
+      const auto datagram3 = make_datagram( "5.6.7.8", "13.12.11.3" );
+      test.execute( SendDatagram { datagram1, Address( "10.0.0.1", 0 ), NetworkInterface::SendResult::Queued } );
+      test.execute( SendDatagram { datagram2, Address( "10.0.0.1", 0 ), NetworkInterface::SendResult::Queued } );
+      test.execute( SendDatagram { datagram3, Address( "10.0.0.1", 0 ), NetworkInterface::SendResult::Dropped } );
+      test.execute( ExpectFrame {
+        make_frame( local_eth,
+                    ETHERNET_BROADCAST,
+                    EthernetHeader::TYPE_ARP,
+                    serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "1.2.3.4", {}, "10.0.0.1" ) ) ) } );
+
+      // The total limit applies across next hops
+      test.execute( SendDatagram { datagram1, Address( "10.0.0.2", 0 ), NetworkInterface::SendResult::Queued } );
+      test.execute( SendDatagram { datagram2, Address( "10.0.0.2", 0 ), NetworkInterface::SendResult::Dropped } );
+      test.execute( ExpectFrame {
+        make_frame( local_eth,
+                    ETHERNET_BROADCAST,
+                    EthernetHeader::TYPE_ARP,
+                    serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "1.2.3.4", {}, "10.0.0.2" ) ) ) } );
+      test.execute( ExpectNoFrame {} );
+      test.execute( ExpectDatagramsPending { 3 } );
+      test.execute( ExpectBytesPending { 75 } );
+      test.execute( ExpectDatagramsDropped { 2 } );
+
+      // The datagrams that were kept go out once the next hop replies
+      const EthernetAddress remote_eth = random_private_ethernet_address();
+      test.execute( ReceiveFrame {
+        make_frame(
+          remote_eth,
+          local_eth,
+          EthernetHeader::TYPE_ARP, // NOLINTNEXTLINE(*-suspicious-*)
+          serialize( make_arp( ARPMessage::OPCODE_REPLY, remote_eth, "10.0.0.1", local_eth, "1.2.3.4" ) ) ),
+        {} } );
+      test.execute(
+        ExpectFrame { make_frame( local_eth, remote_eth, EthernetHeader::TYPE_IPv4, serialize( datagram1 ) ) } );
+      test.execute(
+        ExpectFrame { make_frame( local_eth, remote_eth, EthernetHeader::TYPE_IPv4, serialize( datagram2 ) ) } );
+      test.execute( ExpectNoFrame {} );
+      test.execute( ExpectDatagramsPending { 1 } );
+      test.execute( ExpectBytesPending { 25 } );
+
+      test.execute( SendDatagram { datagram3, Address( "10.0.0.1", 0 ), NetworkInterface::SendResult::Sent } );
+      test.execute(
+        ExpectFrame { make_frame( local_eth, remote_eth, EthernetHeader::TYPE_IPv4, serialize( datagram3 ) ) } );
+    }
+
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      NetworkInterfaceTestHarness test {
+        "datagrams waiting for ARP are capped, dropping the oldest", local_eth, Address( "1.2.3.4", 0 ) };
+      // Room for two 25-byte datagrams per next hop
+      test.execute( SetLimits { { 100, 60, 100, 1000, NetworkInterface::DropPolicy::Oldest } } );
+
+      const auto datagram1 = make_datagram( "5.6.7.8", "13.12.11.1" );
+      const auto datagram2 = make_datagram( "5.6.7.8", "13.12.11.2" );
+      const auto datagram3 = make_datagram( "5.6.7.8", "13.12.11.3" );
+      const auto datagram4 = make_datagram( "5.6.7.8", "13.12.11.4" );
+      test.execute( SendDatagram { datagram1, Address( "10.0.0.1", 0 ), NetworkInterface::SendResult::Queued } );
+      test.execute( SendDatagram { datagram2, Address( "10.0.0.1", 0 ), NetworkInterface::SendResult::Queued } );
+      test.execute( SendDatagram { datagram3, Address( "10.0.0.1", 0 ), NetworkInterface::SendResult::Queued } );
+      test.execute( SendDatagram { datagram4, Address( "10.0.0.1", 0 ), NetworkInterface::SendResult::Queued } );
+      test.execute( ExpectFrame {
+        make_frame( local_eth,
+                    ETHERNET_BROADCAST,
+                    EthernetHeader::TYPE_ARP,
+                    serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "1.2.3.4", {}, "10.0.0.1" ) ) ) } );
+      test.execute( ExpectNoFrame {} );
+      test.execute( ExpectDatagramsPending { 2 } );
+      test.execute( ExpectDatagramsDropped { 2 } );
+
+      const EthernetAddress remote_eth = random_private_ethernet_address();
+      test.execute( ReceiveFrame {
+        make_frame(
+          remote_eth,
+          local_eth,
+          EthernetHeader::TYPE_ARP, // NOLINTNEXTLINE(*-suspicious-*)
+          serialize( make_arp( ARPMessage::OPCODE_REPLY, remote_eth, "10.0.0.1", local_eth, "1.2.3.4" ) ) ),
+        {} } );
+      test.execute(
+        ExpectFrame { make_frame( local_eth, remote_eth, EthernetHeader::TYPE_IPv4, serialize( datagram3 ) ) } );
+      test.execute(
+        ExpectFrame { make_frame( local_eth, remote_eth, EthernetHeader::TYPE_IPv4, serialize( datagram4 ) ) } );
+      test.execute( ExpectNoFrame {} );
+      test.execute( ExpectDatagramsPending { 0 } );
+      test.execute( ExpectBytesPending { 0 } );
+    }
   } catch ( const exception& e ) {
     cerr << e.what() << endl;
     return EXIT_FAILURE;
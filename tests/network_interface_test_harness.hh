@@ -22,19 +22,61 @@ public:
 
 inline std::string summary( const EthernetFrame& frame );
 
+inline std::string to_string( const NetworkInterface::SendResult result )
+{
+  switch ( result ) {
+    case NetworkInterface::SendResult::Sent:
+      return "Sent";
+    case NetworkInterface::SendResult::Queued:
+      return "Queued";
+    case NetworkInterface::SendResult::Dropped:
+      return "Dropped";
+  }
+  return "unknown";
+}
+
 struct SendDatagram : public Action<NetworkInterface>
 {
   InternetDatagram dgram;
   Address next_hop;
+  std::optional<NetworkInterface::SendResult> expected;
 
   std::string description() const override
   {
-    return "request to send datagram (to next hop " + next_hop.ip() + "): " + dgram.header.to_string();
+    return "request to send datagram (to next hop " + next_hop.ip() + "): " + dgram.header.to_string()
+           + ( expected.has_value() ? ", should be " + to_string( expected.value() ) : "" );
   }
 
-  void execute( NetworkInterface& interface ) const override { interface.send_datagram( dgram, next_hop ); }
+  void execute( NetworkInterface& interface ) const override
+  {
+    const auto result = interface.send_datagram( dgram, next_hop );
+    if ( expected.has_value() and result != expected.value() ) {
+      throw ExpectationViolation( "NetworkInterface::send_datagram() returned " + to_string( result )
+                                  + ", but was expected to return " + to_string( expected.value() ) );
+    }
+  }
 
-  SendDatagram( InternetDatagram d, Address n ) : dgram( std::move( d ) ), next_hop( n ) {}
+  SendDatagram( InternetDatagram d, Address n, std::optional<NetworkInterface::SendResult> e = {} )
+    : dgram( std::move( d ) ), next_hop( n ), expected( e )
+  {}
+};
+
+struct SetLimits : public Action<NetworkInterface>
+{
+  NetworkInterface::Limits limits;
+
+  std::string description() const override
+  {
+    return "set limits to " + std::to_string( limits.max_datagrams_per_hop ) + " datagrams/"
+           + std::to_string( limits.max_bytes_per_hop ) + " bytes per hop, "
+           + std::to_string( limits.max_datagrams ) + " datagrams/" + std::to_string( limits.max_bytes )
+           + " bytes in total, dropping "
+           + ( limits.policy == NetworkInterface::DropPolicy::Oldest ? "oldest" : "newest" );
+  }
+
+  void execute( NetworkInterface& interface ) const override { interface.set_limits( limits ); }
+
+  explicit SetLimits( const NetworkInterface::Limits& l ) : limits( l ) {}
 };
 
 template<class T>
@@ -135,6 +177,41 @@ struct Tick : public Action<NetworkInterface>
   explicit Tick( const size_t ms ) : _ms( ms ) {}
 };
 
+struct ExpectArpEntries : public ExpectNumber<NetworkInterface, size_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "arp_entries"; }
+  size_t value( NetworkInterface& interface ) const override { return interface.arp_entries(); }
+};
+
+struct ExpectDatagramsPending : public ExpectNumber<NetworkInterface, size_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "datagrams_pending"; }
+  size_t value( NetworkInterface& interface ) const override { return interface.datagrams_pending(); }
+};
+
+struct ExpectBytesPending : public ExpectNumber<NetworkInterface, size_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "bytes_pending"; }
+  size_t value( NetworkInterface& interface ) const override { return interface.bytes_pending(); }
+};
+
+struct ExpectDatagramsDropped : public ExpectNumber<NetworkInterface, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "datagrams_dropped"; }
+  uint64_t value( NetworkInterface& interface ) const override { return interface.datagrams_dropped(); }
+};
+
+struct ExpectDatagramsTimedOut : public ExpectNumber<NetworkInterface, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "datagrams_timed_out"; }
+  uint64_t value( NetworkInterface& interface ) const override { return interface.datagrams_timed_out(); }
+};
+
 inline std::string concat( std::vector<Buffer>& buffers )
 {
   return std::accumulate(
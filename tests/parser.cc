@@ -0,0 +1,192 @@
+#include "arp_message.hh"
+#include "ipv4_datagram.hh"
+#include "parser.hh"
+#include "random.hh"
+#include "test_should_be.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// `bytes` cut into (non-empty) buffers at the given offsets
+vector<Buffer> split( const string_view bytes, const vector<size_t>& cuts )
+{
+  vector<Buffer> buffers;
+  size_t start = 0;
+  for ( const size_t cut : cuts ) {
+    if ( cut > start ) {
+      buffers.emplace_back( string { bytes.substr( start, cut - start ) } );
+      start = cut;
+    }
+  }
+  if ( start < bytes.size() ) {
+    buffers.emplace_back( string { bytes.substr( start ) } );
+  }
+  return buffers;
+}
+
+struct Integers
+{
+  uint8_t a {};
+  uint16_t b {};
+  uint32_t c {};
+  uint64_t d {};
+
+  void parse( Parser& parser )
+  {
+    parser.integer( a );
+    parser.integer( b );
+    parser.integer( c );
+    parser.integer( d );
+  }
+
+  void serialize( Serializer& serializer ) const
+  {
+    serializer.integer( a );
+    serializer.integer( b );
+    serializer.integer( c );
+    serializer.integer( d );
+  }
+};
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    test_should_be( network_order( uint16_t { 0x0102 } ), uint16_t { 0x0201 } );
+    test_should_be( network_order( uint32_t { 0x01020304 } ), uint32_t { 0x04030201 } );
+    test_should_be( network_order( uint64_t { 0x0102030405060708 } ), uint64_t { 0x0807060504030201 } );
+
+    // Integers are read big-endian, whether they lie in one buffer or straddle several
+    {
+      const string bytes = "\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f";
+      for ( size_t first = 1; first < bytes.size(); ++first ) {
+        for ( size_t second = first; second < bytes.size(); ++second ) {
+          Integers integers;
+          test_should_be( parse( integers, split( bytes, { first, second } ) ), true );
+          test_should_be( integers.a, uint8_t { 0x01 } );
+          test_should_be( integers.b, uint16_t { 0x0203 } );
+          test_should_be( integers.c, uint32_t { 0x04050607 } );
+          test_should_be( integers.d, uint64_t { 0x08090a0b0c0d0e0f } );
+        }
+      }
+
+      // ... including when buffers are one byte long
+      Integers integers;
+      test_should_be( parse( integers, split( bytes, { 0, 1, 1, 2, 3, 4, 5, 5, 9, 10, 11 } ) ), true );
+      test_should_be( integers.c, uint32_t { 0x04050607 } );
+      test_should_be( integers.d, uint64_t { 0x08090a0b0c0d0e0f } );
+    }
+
+    // Too few bytes is an error, however they are split
+    {
+      Integers integers;
+      test_should_be( parse( integers, split( string( 14, 'x' ), { 3, 7 } ) ), false );
+      test_should_be( parse( integers, vector<Buffer> {} ), false );
+    }
+
+    // Random integers survive a round trip, cut anywhere
+    {
+      uniform_int_distribution<size_t> cut { 0, 15 };
+      uniform_int_distribution<uint64_t> bits;
+      for ( size_t i = 0; i < 1000; ++i ) {
+        const uint64_t x = bits( rd );
+        const Integers original { static_cast<uint8_t>( x ),
+                                  static_cast<uint16_t>( x >> 8 ),
+                                  static_cast<uint32_t>( x >> 24 ),
+                                  bits( rd ) };
+        string bytes;
+        for ( const auto& buffer : serialize( original ) ) {
+          bytes += string_view { buffer };
+        }
+        const size_t first = cut( rd );
+        const size_t second = max( first, cut( rd ) );
+
+        Integers parsed;
+        test_should_be( parse( parsed, split( bytes, { first, second } ) ), true );
+        test_should_be( parsed.a, original.a );
+        test_should_be( parsed.b, original.b );
+        test_should_be( parsed.c, original.c );
+        test_should_be( parsed.d, original.d );
+      }
+    }
+
+    // Headers on the per-packet path parse the same from one buffer as from many
+    {
+      IPv4Datagram dgram;
+      dgram.header.proto = 17;
+      dgram.header.src = 0x0a000102;
+      dgram.header.dst = 0xc0a80001;
+      dgram.header.id = 0x1234;
+      dgram.header.len = static_cast<uint16_t>( dgram.header.hlen * 4 + 3 );
+      dgram.header.ttl = 64;
+      dgram.header.compute_checksum();
+      dgram.payload.emplace_back( "abc" );
+      string bytes;
+      for ( const auto& buffer : serialize( dgram ) ) {
+        bytes += string_view { buffer };
+      }
+
+      for ( size_t cut = 0; cut <= IPv4Header::LENGTH; ++cut ) {
+        IPv4Datagram parsed;
+        test_should_be( parse( parsed, split( bytes, { cut } ) ), true );
+        test_should_be( parsed.header.src, dgram.header.src );
+        test_should_be( parsed.header.dst, dgram.header.dst );
+        test_should_be( parsed.header.id, dgram.header.id );
+        test_should_be( parsed.header.cksum, dgram.header.cksum );
+      }
+
+      ARPMessage message;
+      message.opcode = ARPMessage::OPCODE_REPLY;
+      message.sender_ethernet_address = { 1, 2, 3, 4, 5, 6 };
+      message.sender_ip_address = 0x0a000001;
+      message.target_ethernet_address = { 6, 5, 4, 3, 2, 1 };
+      message.target_ip_address = 0x0a000002;
+      string arp_bytes;
+      for ( const auto& buffer : serialize( message ) ) {
+        arp_bytes += string_view { buffer };
+      }
+      for ( size_t cut = 0; cut <= arp_bytes.size(); ++cut ) {
+        ARPMessage parsed;
+        test_should_be( parse( parsed, split( arp_bytes, { cut } ) ), true );
+        test_should_be( parsed.sender_ip_address, message.sender_ip_address );
+        test_should_be( parsed.target_ip_address, message.target_ip_address );
+        test_should_be( parsed.opcode, message.opcode );
+      }
+    }
+
+    // The Serializer writes an object's own bytes into one Buffer, and passes borrowed Buffers along
+    {
+      ARPMessage message;
+      message.opcode = ARPMessage::OPCODE_REQUEST;
+      const vector<Buffer> arp = serialize( message );
+      test_should_be( arp.size(), size_t { 1 } );
+      test_should_be( arp.front().size(), size_t { ARPMessage::LENGTH } );
+
+      IPv4Datagram dgram;
+      dgram.payload.emplace_back( "borrowed" );
+      const vector<Buffer> datagram = serialize( dgram );
+      test_should_be( datagram.size(), size_t { 2 } );
+      test_should_be( datagram.front().size(), size_t { IPv4Header::LENGTH } );
+      const bool borrowed = string_view { datagram.back() }.data() == string_view { dgram.payload.front() }.data();
+      test_should_be( borrowed, true );
+
+      // Nothing written, nothing output
+      Serializer serializer;
+      test_should_be( serializer.output().size(), size_t { 0 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,120 @@
+#include "rcu.hh"
+#include "test_should_be.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// A snapshot whose contents can be checked for consistency: every element equals `version`.
+struct Snapshot
+{
+  uint64_t version;
+  vector<uint64_t> values;
+};
+
+unique_ptr<const Snapshot> make_snapshot( const uint64_t version )
+{
+  return make_unique<const Snapshot>( Snapshot { version, vector<uint64_t>( 64, version ) } );
+}
+
+int main()
+{
+  try {
+    // Replaced snapshots are freed only once every online reader has passed a quiescent state
+    {
+      Rcu<Snapshot> rcu { make_snapshot( 0 ) };
+      const size_t first = rcu.register_reader();
+      const size_t second = rcu.register_reader();
+
+      rcu.publish( make_snapshot( 1 ) );
+      test_should_be( rcu.read().version, uint64_t { 1 } );
+      test_should_be( rcu.retired(), size_t { 1 } );
+
+      rcu.quiescent( first );
+      test_should_be( rcu.retired(), size_t { 1 } );
+      rcu.quiescent( second );
+      test_should_be( rcu.retired(), size_t { 0 } );
+
+      // An offline reader does not hold up reclamation
+      rcu.offline( second );
+      rcu.publish( make_snapshot( 2 ) );
+      rcu.publish( make_snapshot( 3 ) );
+      test_should_be( rcu.retired(), size_t { 2 } );
+      rcu.quiescent( first );
+      test_should_be( rcu.retired(), size_t { 0 } );
+
+      // ... and neither does an unregistered one
+      rcu.quiescent( second );
+      rcu.publish( make_snapshot( 4 ) );
+      rcu.quiescent( first );
+      rcu.unregister_reader( second );
+      test_should_be( rcu.retired(), size_t { 0 } );
+      test_should_be( rcu.read().version, uint64_t { 4 } );
+    }
+
+    // A reader registered offline holds nothing up, and try_reclaim() frees what waited for a reader
+    {
+      Rcu<Snapshot> rcu { make_snapshot( 0 ) };
+      const size_t reader = rcu.register_reader( false );
+      rcu.publish( make_snapshot( 1 ) );
+      test_should_be( rcu.retired_unreclaimed(), size_t { 0 } );
+
+      rcu.quiescent( reader );
+      rcu.publish( make_snapshot( 2 ) );
+      test_should_be( rcu.retired_unreclaimed(), size_t { 1 } );
+      rcu.try_reclaim();
+      test_should_be( rcu.retired_unreclaimed(), size_t { 1 } );
+
+      rcu.offline( reader );
+      rcu.try_reclaim();
+      test_should_be( rcu.retired_unreclaimed(), size_t { 0 } );
+      test_should_be( rcu.read().version, uint64_t { 2 } );
+    }
+
+    // A reader on another thread keeps reading consistent snapshots while they are replaced
+    {
+      Rcu<Snapshot> rcu { make_snapshot( 0 ) };
+      atomic<bool> done { false };
+      bool consistent = true;
+      bool in_order = true;
+
+      thread reader { [&] {
+        const size_t me = rcu.register_reader();
+        uint64_t last_version = 0;
+        while ( not done ) {
+          const Snapshot& snapshot = rcu.read();
+          for ( const uint64_t value : snapshot.values ) {
+            consistent = consistent and value == snapshot.version;
+          }
+          in_order = in_order and snapshot.version >= last_version;
+          last_version = snapshot.version;
+          rcu.quiescent( me );
+        }
+        rcu.unregister_reader( me );
+      } };
+
+      constexpr uint64_t NUM_PUBLICATIONS = 20000;
+      for ( uint64_t version = 1; version <= NUM_PUBLICATIONS; version++ ) {
+        rcu.publish( make_snapshot( version ) );
+      }
+      done = true;
+      reader.join();
+
+      test_should_be( consistent, true );
+      test_should_be( in_order, true );
+      test_should_be( rcu.retired(), size_t { 0 } );
+      test_should_be( rcu.read().version, NUM_PUBLICATIONS );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
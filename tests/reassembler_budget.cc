@@ -0,0 +1,230 @@
+#include "reassembler_test_harness.hh"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main()
+{
+  try {
+    // Accounting is the same with either storage
+    {
+      ReassemblerTestHarness test { "accounting", 65000 };
+
+      test.execute( Insert { "b", 1 } );
+      test.execute( Insert { "d", 3 } );
+      test.execute( Insert { "fgh", 5 } );
+      test.execute( BytesPending( 5 ) );
+      test.execute( IntervalsPending( 3 ) );
+      test.execute( PeakBytesPending( 5 ) );
+
+      test.execute( Insert { "abcde", 0 } );
+      test.execute( BytesPending( 0 ) );
+      test.execute( IntervalsPending( 0 ) );
+      test.execute( PeakBytesPending( 5 ) );
+      test.execute( BytesDropped( 0 ) );
+      test.execute( ReadAll( "abcdefgh" ) );
+    }
+
+    {
+      ReassemblerTestHarness test { "adjacent inserts are one interval", 65000 };
+
+      test.execute( Insert { "b", 1 } );
+      test.execute( Insert { "d", 3 } );
+      test.execute( IntervalsPending( 2 ) );
+      test.execute( Insert { "c", 2 } );
+      test.execute( IntervalsPending( 1 ) );
+      test.execute( Insert { "e", 4 } );
+      test.execute( Insert { "g", 6 } );
+      test.execute( BytesPending( 5 ) );
+      test.execute( IntervalsPending( 2 ) );
+
+      test.execute( Insert { "a", 0 } );
+      test.execute( ReadAll( "abcde" ) );
+      test.execute( BytesPending( 1 ) );
+      test.execute( IntervalsPending( 1 ) );
+    }
+
+    // Limits are enforced by the Intervals storage (see Reassembler::Limits)
+    {
+      ReassemblerTestHarness test {
+        "interval cap keeps adjacent inserts", 65000, Reassembler::Storage::Intervals };
+
+      test.execute( SetLimits( { .max_intervals = 1 } ) );
+      test.execute( Insert { "b", 1 } );
+      test.execute( Insert { "c", 2 } );
+      test.execute( Insert { "de", 3 } );
+      test.execute( IntervalsPending( 1 ) );
+      test.execute( BytesPending( 4 ) );
+      test.execute( BytesDropped( 0 ) );
+
+      test.execute( Insert { "g", 6 } );
+      test.execute( IntervalsPending( 1 ) );
+      test.execute( BytesDropped( 1 ) );
+
+      test.execute( Insert { "a", 0 } );
+      test.execute( ReadAll( "abcde" ) );
+      test.execute( BytesPending( 0 ) );
+    }
+
+    {
+      ReassemblerTestHarness test {
+        "byte cap drops newest bytes of a merged interval", 65000, Reassembler::Storage::Intervals };
+
+      test.execute( SetLimits( { .max_bytes_pending = 3, .policy = Reassembler::DropPolicy::Newest } ) );
+      test.execute( Insert { "bc", 1 } );
+      test.execute( Insert { "de", 3 } );
+      test.execute( BytesPending( 3 ) );
+      test.execute( IntervalsPending( 1 ) );
+      test.execute( BytesDropped( 1 ) );
+
+      // Bytes dropped from between two held intervals leave them separate
+      test.execute( SetLimits( { .max_bytes_pending = 5, .policy = Reassembler::DropPolicy::Newest } ) );
+      test.execute( Insert { "gh", 6 } );
+      test.execute( Insert { "ef", 4 } );
+      test.execute( BytesPending( 5 ) );
+      test.execute( IntervalsPending( 2 ) );
+      test.execute( BytesDropped( 3 ) );
+
+      test.execute( Insert { "a", 0 } );
+      test.execute( ReadAll( "abcd" ) );
+      test.execute( Insert { "ef", 4 } );
+      test.execute( ReadAll( "efgh" ) );
+    }
+
+    {
+      ReassemblerTestHarness test {
+        "byte cap cuts an interval merged in reverse", 65000, Reassembler::Storage::Intervals };
+
+      test.execute( Insert { "fg", 5 } );
+      test.execute( Insert { "de", 3 } );
+      test.execute( Insert { "c", 2 } );
+      test.execute( Insert { "b", 1 } );
+      test.execute( IntervalsPending( 1 ) );
+      test.execute( SetLimits( { .max_bytes_pending = 3 } ) );
+      test.execute( BytesPending( 3 ) );
+      test.execute( BytesDropped( 3 ) );
+
+      test.execute( Insert { "a", 0 } );
+      test.execute( ReadAll( "abcd" ) );
+      test.execute( Insert { "efgh", 4 } );
+      test.execute( ReadAll( "efgh" ) );
+    }
+
+    {
+      ReassemblerTestHarness test { "byte cap drops furthest bytes", 65000, Reassembler::Storage::Intervals };
+
+      test.execute( SetLimits( { .max_bytes_pending = 4 } ) );
+      test.execute( Insert { "cd", 2 } );
+      test.execute( Insert { "ghij", 6 } );
+      test.execute( BytesPending( 4 ) );
+      test.execute( BytesDropped( 2 ) );
+      test.execute( PeakBytesPending( 4 ) );
+
+      test.execute( Insert { "ab", 0 } );
+      test.execute( ReadAll( "abcd" ) );
+      test.execute( Insert { "ef", 4 } );
+      test.execute( ReadAll( "efgh" ) );
+      test.execute( BytesPending( 0 ) );
+    }
+
+    {
+      ReassemblerTestHarness test { "byte cap drops newest bytes", 65000, Reassembler::Storage::Intervals };
+
+      test.execute( SetLimits( { .max_bytes_pending = 4, .policy = Reassembler::DropPolicy::Newest } ) );
+      test.execute( Insert { "ghij", 6 } );
+      test.execute( Insert { "cd", 2 } );
+      test.execute( BytesPending( 4 ) );
+      test.execute( BytesDropped( 2 ) );
+
+      test.execute( Insert { "abcdef", 0 } );
+      test.execute( ReadAll( "abcdefghij" ) );
+      test.execute( BytesPending( 0 ) );
+      test.execute( BytesDropped( 2 ) );
+    }
+
+    {
+      ReassemblerTestHarness test {
+        "interval cap drops furthest interval", 65000, Reassembler::Storage::Intervals };
+
+      test.execute( SetLimits( { .max_intervals = 2 } ) );
+      test.execute( Insert { "b", 1 } );
+      test.execute( Insert { "f", 5 } );
+      test.execute( Insert { "d", 3 } );
+      test.execute( IntervalsPending( 2 ) );
+      test.execute( BytesPending( 2 ) );
+      test.execute( BytesDropped( 1 ) );
+
+      test.execute( Insert { "a", 0 } );
+      test.execute( ReadAll( "ab" ) );
+      test.execute( Insert { "c", 2 } );
+      test.execute( ReadAll( "cd" ) );
+    }
+
+    {
+      ReassemblerTestHarness test { "interval cap drops newest interval", 65000, Reassembler::Storage::Intervals };
+
+      test.execute( SetLimits( { .max_intervals = 1, .policy = Reassembler::DropPolicy::Newest } ) );
+      test.execute( Insert { "d", 3 } );
+      test.execute( Insert { "b", 1 } );
+      test.execute( IntervalsPending( 1 ) );
+      test.execute( BytesPending( 1 ) );
+
+      test.execute( Insert { "abc", 0 } );
+      test.execute( ReadAll( "abcd" ) );
+    }
+
+    {
+      ReassemblerTestHarness test {
+        "lowering the limits drops held bytes", 65000, Reassembler::Storage::Intervals };
+
+      test.execute( Insert { "bcdefg", 1 } );
+      test.execute( SetLimits( { .max_bytes_pending = 2 } ) );
+      test.execute( BytesPending( 2 ) );
+      test.execute( BytesDropped( 4 ) );
+      test.execute( PeakBytesPending( 6 ) );
+      test.execute( Insert { "a", 0 } );
+      test.execute( ReadAll( "abc" ) );
+    }
+
+    {
+      ReassemblerTestHarness test { "accounting with bitmap storage", 65000, Reassembler::Storage::Bitmap };
+
+      test.execute( Insert { "b", 1 } );
+      test.execute( Insert { "d", 3 } );
+      test.execute( Insert { "fgh", 5 } );
+      test.execute( Insert { "e", 4 } );
+      test.execute( BytesPending( 6 ) );
+      test.execute( IntervalsPending( 2 ) );
+      test.execute( PeakBytesPending( 6 ) );
+
+      test.execute( Insert { "a", 0 } );
+      test.execute( ReadAll( "ab" ) );
+      test.execute( IntervalsPending( 1 ) );
+    }
+
+    // Bitmap storage has no limits to enforce: it accepts only limits that cap nothing
+    {
+      Reassembler reassembler { Reassembler::Storage::Bitmap };
+      reassembler.set_limits( { .policy = Reassembler::DropPolicy::Newest } );
+      for ( const Reassembler::Limits limits : { Reassembler::Limits { .max_bytes_pending = 100 },
+                                                 Reassembler::Limits { .max_intervals = 4 } } ) {
+        bool rejected = false;
+        try {
+          reassembler.set_limits( limits );
+        } catch ( const runtime_error& ) {
+          rejected = true;
+        }
+        if ( not rejected ) {
+          throw runtime_error( "Bitmap storage accepted limits it does not enforce" );
+        }
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
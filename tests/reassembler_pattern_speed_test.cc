@@ -0,0 +1,211 @@
+#include "reassembler.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+// Count every allocation made by the program, so the benchmark can report allocations per segment.
+namespace {
+uint64_t allocations = 0; // NOLINT(*-non-const-global-variables)
+}
+
+void* operator new( size_t size )
+{
+  ++allocations;
+  if ( void* ptr = malloc( size ) ) { // NOLINT(*-no-malloc)
+    return ptr;
+  }
+  throw bad_alloc {};
+}
+
+void operator delete( void* ptr ) noexcept
+{
+  free( ptr ); // NOLINT(*-no-malloc)
+}
+
+void operator delete( void* ptr, size_t /* size */ ) noexcept
+{
+  free( ptr ); // NOLINT(*-no-malloc)
+}
+
+static constexpr uint64_t CAPACITY = 65536;
+
+using Segment = tuple<uint64_t, string, bool>;
+
+struct Pattern
+{
+  string name;
+  size_t segment_size;
+  size_t depth;             // How far (in segments) a segment may be moved from its place in the stream
+  double duplicate_rate;    // Probability that a segment is sent a second time
+  double loss_rate;         // Probability that a segment is lost, then retransmitted `depth` segments later
+  bool reversed_windows {}; // Send each window of `depth` segments in reverse order
+};
+
+// Produce the segments the sender would send, in the order they arrive at the Reassembler. No segment
+// is ever sent further than the capacity ahead of the earliest missing byte, so every byte eventually
+// reaches the output.
+vector<Segment> schedule( const string& data, const Pattern& pattern, default_random_engine& rd )
+{
+  vector<Segment> in_order;
+  for ( size_t i = 0; i < data.size(); i += pattern.segment_size ) {
+    in_order.emplace_back( i, data.substr( i, pattern.segment_size ), i + pattern.segment_size >= data.size() );
+  }
+
+  vector<Segment> sent;
+  sent.reserve( in_order.size() * 2 );
+  bernoulli_distribution duplicate { pattern.duplicate_rate };
+  bernoulli_distribution loss { pattern.loss_rate };
+  deque<pair<size_t, Segment>> retransmissions;
+
+  for ( size_t block = 0; block < in_order.size(); block += pattern.depth ) {
+    const auto first = in_order.begin() + static_cast<ptrdiff_t>( block );
+    const auto last = in_order.begin() + static_cast<ptrdiff_t>( min( block + pattern.depth, in_order.size() ) );
+    vector<Segment> window { first, last };
+    if ( pattern.reversed_windows ) {
+      reverse( window.begin(), window.end() );
+    } else if ( pattern.depth > 1 ) {
+      shuffle( window.begin(), window.end(), rd );
+    }
+
+    for ( auto& segment : window ) {
+      // A sender never runs a full capacity ahead of its oldest unacknowledged segment: retransmit
+      // early rather than send bytes the receiver would have to drop.
+      const uint64_t segment_end = get<0>( segment ) + get<1>( segment ).size();
+      while ( any_of( retransmissions.begin(), retransmissions.end(), [&]( const auto& pending ) {
+        return get<0>( pending.second ) + CAPACITY < segment_end;
+      } ) ) {
+        sent.push_back( std::move( retransmissions.front().second ) );
+        retransmissions.pop_front();
+      }
+
+      if ( loss( rd ) ) {
+        retransmissions.emplace_back( sent.size() + pattern.depth, std::move( segment ) );
+      } else {
+        if ( duplicate( rd ) ) {
+          sent.push_back( segment );
+        }
+        sent.push_back( std::move( segment ) );
+      }
+
+      while ( !retransmissions.empty() && retransmissions.front().first <= sent.size() ) {
+        sent.push_back( std::move( retransmissions.front().second ) );
+        retransmissions.pop_front();
+      }
+    }
+  }
+  for ( auto& [when, segment] : retransmissions ) {
+    sent.push_back( std::move( segment ) );
+  }
+
+  return sent;
+}
+
+void speed_test( const string& data, const Pattern& pattern, const Reassembler::Storage storage )
+{
+  default_random_engine rd { 1370 };
+  vector<Segment> segments = schedule( data, pattern, rd );
+  const size_t num_segments = segments.size();
+
+  ByteStream stream { CAPACITY };
+  Reassembler reassembler { storage };
+
+  string output_data;
+  output_data.reserve( data.size() );
+
+  const uint64_t allocations_before = allocations;
+  const auto start_time = steady_clock::now();
+  for ( auto& [first_index, payload, is_last] : segments ) {
+    reassembler.insert( first_index, std::move( payload ), is_last, stream.writer() );
+
+    while ( stream.reader().bytes_buffered() ) {
+      const auto peeked = stream.reader().peek();
+      output_data += peeked;
+      stream.reader().pop( peeked.size() );
+    }
+  }
+  const auto stop_time = steady_clock::now();
+  const uint64_t allocations_during = allocations - allocations_before;
+
+  if ( not stream.reader().is_finished() ) {
+    throw runtime_error( "Reassembler did not close ByteStream when finished (" + pattern.name + ")" );
+  }
+
+  if ( data != output_data ) {
+    throw runtime_error( "Mismatch between data written and read (" + pattern.name + ")" );
+  }
+
+  auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  auto bytes_per_second = static_cast<double>( data.size() ) / test_duration.count();
+  auto gigabits_per_second = 8 * bytes_per_second / 1e9;
+
+  const string storage_name = storage == Reassembler::Storage::Bitmap ? "(bitmap)" : "(intervals)";
+  cout << "Reassembler " << left << setw( 12 ) << storage_name << setw( 36 ) << pattern.name + ":" << right
+       << fixed << setprecision( 2 ) << setw( 6 ) << gigabits_per_second << " Gbit/s, " << setw( 5 )
+       << static_cast<double>( allocations_during ) / static_cast<double>( num_segments )
+       << " allocations/segment, peak bytes_pending=" << reassembler.peak_bytes_pending() << "\n";
+
+  if ( gigabits_per_second < 0.1 ) {
+    throw runtime_error( "Reassembler did not meet minimum speed of 0.1 Gbit/s (" + pattern.name + ")." );
+  }
+}
+
+void program_body()
+{
+  const string data = [] {
+    default_random_engine rd { 789 };
+    uniform_int_distribution<char> ud;
+    string ret;
+    for ( size_t i = 0; i < 8'000'000; ++i ) {
+      ret += ud( rd );
+    }
+    return ret;
+  }();
+
+  const vector<Pattern> patterns {
+    { "in order, segment=536", 536, 1, 0, 0 },
+    { "in order, segment=1460", 1460, 1, 0, 0 },
+    { "in order, segment=8192", 8192, 1, 0, 0 },
+    { "reorder depth=4, segment=1460", 1460, 4, 0, 0 },
+    { "reorder depth=32, segment=1460", 1460, 32, 0, 0 },
+    { "reorder depth=32, segment=536", 536, 32, 0, 0 },
+    { "duplicates 10%, segment=1460", 1460, 1, 0.1, 0 },
+    { "duplicates 50%, depth=8", 1460, 8, 0.5, 0 },
+    { "loss 1% then retransmit, depth=16", 1460, 16, 0, 0.01 },
+    { "loss 10% then retransmit, depth=16", 1460, 16, 0, 0.1 },
+    { "reversed windows of 40 x 1460", 1460, 40, 0, 0, true },
+    { "reversed windows of 120 x 536", 536, 120, 0, 0, true },
+  };
+
+  for ( const auto& pattern : patterns ) {
+    if ( ( pattern.depth + 1 ) * pattern.segment_size > CAPACITY ) {
+      throw runtime_error( "pattern does not fit in the capacity: " + pattern.name );
+    }
+    speed_test( data, pattern, Reassembler::Storage::Intervals );
+    speed_test( data, pattern, Reassembler::Storage::Bitmap );
+  }
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
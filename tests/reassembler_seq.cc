@@ -79,6 +79,24 @@ int main()
       test.execute( ReadAll(
         { 0x0d, 0x0a, 0x63, 0x61, 0x0a, 0x66, 0x65, 0x20, 0x62, 0x30, 0x0d, 0x62, 0x00, 0x61, 0x00, 0x00 } ) );
     }
+    {
+      ReassemblerTestHarness test { "in-order fast path", 8 };
+
+      test.execute( Insert { "abcd", 0 } );
+      test.execute( FastPathInserts { 1 } );
+      test.execute( Insert { "ghij", 6 } );
+      test.execute( FastPathInserts { 1 } );
+      test.execute( BytesPending { 2 } );
+      test.execute( Insert { "ef", 4 } );
+      test.execute( FastPathInserts { 1 } );
+      test.execute( BytesPending { 0 } );
+      test.execute( ReadAll( "abcdefgh" ) );
+      test.execute( Insert { "ijklmnopqrst", 8 } );
+      test.execute( FastPathInserts { 2 } );
+      test.execute( BytesPushed( 16 ) );
+      test.execute( ReadAll( "ijklmnop" ) );
+    }
+
   } catch ( const exception& e ) {
     cerr << "Exception: " << e.what() << endl;
     return EXIT_FAILURE;
@@ -13,9 +13,10 @@
 using namespace std;
 using namespace std::chrono;
 
-void speed_test( const size_t num_chunks,   // NOLINT(bugprone-easily-swappable-parameters)
-                 const size_t capacity,     // NOLINT(bugprone-easily-swappable-parameters)
-                 const size_t random_seed ) // NOLINT(bugprone-easily-swappable-parameters)
+void speed_test( const size_t num_chunks,  // NOLINT(bugprone-easily-swappable-parameters)
+                 const size_t capacity,    // NOLINT(bugprone-easily-swappable-parameters)
+                 const size_t random_seed, // NOLINT(bugprone-easily-swappable-parameters)
+                 const Reassembler::Storage storage = Reassembler::Storage::Intervals )
 {
   // Generate the data to be written
   const string data = [&] {
@@ -37,7 +38,7 @@ void speed_test( const size_t num_chunks,   // NOLINT(bugprone-easily-swappable-
   }
 
   ByteStream stream { capacity };
-  Reassembler reassembler;
+  Reassembler reassembler { storage };
 
   string output_data;
   output_data.reserve( data.size() );
@@ -72,11 +73,13 @@ void speed_test( const size_t num_chunks,   // NOLINT(bugprone-easily-swappable-
   fstream debug_output;
   debug_output.open( "/dev/tty" );
 
-  cout << "Reassembler to ByteStream with capacity=" << capacity << " reached " << fixed << setprecision( 2 )
-       << gigabits_per_second << " Gbit/s.\n";
+  const string storage_name = storage == Reassembler::Storage::Bitmap ? " (bitmap)" : "";
 
-  debug_output << "             Reassembler throughput: " << fixed << setprecision( 2 ) << gigabits_per_second
-               << " Gbit/s\n";
+  cout << "Reassembler" << storage_name << " to ByteStream with capacity=" << capacity << " reached " << fixed
+       << setprecision( 2 ) << gigabits_per_second << " Gbit/s.\n";
+
+  debug_output << "             Reassembler" << storage_name << " throughput: " << fixed << setprecision( 2 )
+               << gigabits_per_second << " Gbit/s\n";
 
   if ( gigabits_per_second < 0.1 ) {
     throw runtime_error( "Reassembler did not meet minimum speed of 0.1 Gbit/s." );
@@ -86,6 +89,7 @@ void speed_test( const size_t num_chunks,   // NOLINT(bugprone-easily-swappable-
 void program_body()
 {
   speed_test( 10000, 1500, 1370 );
+  speed_test( 10000, 1500, 1370, Reassembler::Storage::Bitmap );
 }
 
 int main()
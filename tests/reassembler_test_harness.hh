@@ -4,12 +4,23 @@
 #include "common.hh"
 #include "reassembler.hh"
 
+#include <cstdlib>
 #include <optional>
 #include <sstream>
+#include <string_view>
 #include <utility>
 
 using StreamAndReassembler = std::pair<ByteStream, Reassembler>;
 
+// The storage of a test that doesn't choose one: Bitmap if the REASSEMBLER_STORAGE environment
+// variable says "bitmap" (as it does for the *_bitmap runs of each test), Intervals otherwise
+inline Reassembler::Storage default_reassembler_storage()
+{
+  const char* storage = getenv( "REASSEMBLER_STORAGE" );
+  return storage and std::string_view { storage } == "bitmap" ? Reassembler::Storage::Bitmap
+                                                              : Reassembler::Storage::Intervals;
+}
+
 template<std::derived_from<TestStep<ByteStream>> T>
 struct ReassemblerByteStreamTestStep : public TestStep<StreamAndReassembler>
 {
@@ -28,10 +39,13 @@ struct ReassemblerByteStreamTestStep : public TestStep<StreamAndReassembler>
 class ReassemblerTestHarness : public TestHarness<StreamAndReassembler>
 {
 public:
-  ReassemblerTestHarness( std::string test_name, uint64_t capacity )
+  ReassemblerTestHarness( std::string test_name,
+                          uint64_t capacity,
+                          Reassembler::Storage storage = default_reassembler_storage() )
     : TestHarness( move( test_name ),
-                   "capacity=" + std::to_string( capacity ),
-                   { ByteStream { capacity }, Reassembler {} } )
+                   "capacity=" + std::to_string( capacity )
+                     + ( storage == Reassembler::Storage::Bitmap ? ", storage=bitmap" : "" ),
+                   { ByteStream { capacity }, Reassembler { storage } } )
   {}
 
   template<std::derived_from<TestStep<ByteStream>> T>
@@ -50,6 +64,50 @@ struct BytesPending : public ExpectNumber<StreamAndReassembler, uint64_t>
   uint64_t value( StreamAndReassembler& sr ) const override { return sr.second.bytes_pending(); }
 };
 
+struct FastPathInserts : public ExpectNumber<StreamAndReassembler, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "fast_path_inserts"; }
+  uint64_t value( StreamAndReassembler& sr ) const override { return sr.second.fast_path_inserts(); }
+};
+
+struct IntervalsPending : public ExpectNumber<StreamAndReassembler, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "intervals_pending"; }
+  uint64_t value( StreamAndReassembler& sr ) const override { return sr.second.intervals_pending(); }
+};
+
+struct PeakBytesPending : public ExpectNumber<StreamAndReassembler, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "peak_bytes_pending"; }
+  uint64_t value( StreamAndReassembler& sr ) const override { return sr.second.peak_bytes_pending(); }
+};
+
+struct BytesDropped : public ExpectNumber<StreamAndReassembler, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "bytes_dropped"; }
+  uint64_t value( StreamAndReassembler& sr ) const override { return sr.second.bytes_dropped(); }
+};
+
+struct SetLimits : public Action<StreamAndReassembler>
+{
+  Reassembler::Limits limits_;
+
+  explicit SetLimits( const Reassembler::Limits& limits ) : limits_( limits ) {}
+
+  std::string description() const override
+  {
+    return "set limits: max_bytes_pending=" + std::to_string( limits_.max_bytes_pending )
+           + ", max_intervals=" + std::to_string( limits_.max_intervals ) + ", policy="
+           + ( limits_.policy == Reassembler::DropPolicy::Newest ? "newest" : "furthest" );
+  }
+
+  void execute( StreamAndReassembler& sr ) const override { sr.second.set_limits( limits_ ); }
+};
+
 struct Insert : public Action<StreamAndReassembler>
 {
   std::string data_;
@@ -21,7 +21,8 @@ int main()
 
     // overlapping segments
     for ( unsigned rep_no = 0; rep_no < NREPS; ++rep_no ) {
-      ReassemblerTestHarness sr { "win test " + to_string( rep_no ), NSEGS * MAX_SEG_LEN };
+      const auto storage = rep_no % 2 ? Reassembler::Storage::Bitmap : Reassembler::Storage::Intervals;
+      ReassemblerTestHarness sr { "win test " + to_string( rep_no ), NSEGS * MAX_SEG_LEN, storage };
 
       vector<tuple<size_t, size_t>> seq_size;
       size_t offset = 0;
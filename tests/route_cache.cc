@@ -0,0 +1,102 @@
+#include "random.hh"
+#include "route_cache.hh"
+#include "test_should_be.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <span>
+#include <vector>
+
+using namespace std;
+
+int64_t interface_num( const Route* route )
+{
+  return route ? static_cast<int64_t>( route->interface_num ) : -1;
+}
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    RoutingTable routing_table;
+    routing_table.at( 8 ).insert_or_assign( 0x0a000000, Route { {}, 8 } );
+    routing_table.at( 24 ).insert_or_assign( 0x0a010200, Route { {}, 24 } );
+    const ForwardingTable table { routing_table };
+
+    // Misses go to the table, and repeated lookups hit, including for addresses with no route
+    {
+      RouteCache cache { 64 };
+      test_should_be( cache.size(), size_t { 64 } );
+      test_should_be( interface_num( cache.lookup( table, 0x0a010203 ) ), int64_t { 24 } );
+      test_should_be( interface_num( cache.lookup( table, 0x0a020304 ) ), int64_t { 8 } );
+      test_should_be( interface_num( cache.lookup( table, 0x0b000001 ) ), int64_t { -1 } );
+      test_should_be( cache.hits(), uint64_t { 0 } );
+      test_should_be( cache.misses(), uint64_t { 3 } );
+
+      test_should_be( interface_num( cache.lookup( table, 0x0a010203 ) ), int64_t { 24 } );
+      test_should_be( interface_num( cache.lookup( table, 0x0a020304 ) ), int64_t { 8 } );
+      test_should_be( interface_num( cache.lookup( table, 0x0b000001 ) ), int64_t { -1 } );
+      test_should_be( cache.hits(), uint64_t { 3 } );
+      test_should_be( cache.misses(), uint64_t { 3 } );
+
+      // Clearing the cache invalidates every entry
+      cache.clear();
+      test_should_be( interface_num( cache.lookup( table, 0x0a010203 ) ), int64_t { 24 } );
+      test_should_be( cache.misses(), uint64_t { 4 } );
+    }
+
+    // A new table (as after a route change) invalidates the cache
+    {
+      RouteCache cache { 64 };
+      test_should_be( interface_num( cache.lookup( table, 0x0a010203 ) ), int64_t { 24 } );
+
+      RoutingTable changed = routing_table;
+      changed.at( 24 ).erase( 0x0a010200 );
+      const ForwardingTable new_table { changed };
+      test_should_be( interface_num( cache.lookup( new_table, 0x0a010203 ) ), int64_t { 8 } );
+      test_should_be( cache.hits(), uint64_t { 0 } );
+      test_should_be( cache.misses(), uint64_t { 2 } );
+      test_should_be( interface_num( cache.lookup( new_table, 0x0a010203 ) ), int64_t { 8 } );
+      test_should_be( cache.hits(), uint64_t { 1 } );
+    }
+
+    // A small cache always gives the same answers as the table, whatever it evicts
+    {
+      RouteCache cache { 16 };
+      uniform_int_distribution<uint32_t> low_bits { 0, 0x3ff };
+      for ( size_t i = 0; i < 10'000; ++i ) {
+        const uint32_t address = 0x0a010000 | low_bits( rd );
+        test_should_be( interface_num( cache.lookup( table, address ) ), interface_num( table.lookup( address ) ) );
+      }
+      test_should_be( cache.hits() + cache.misses(), uint64_t { 10'000 } );
+    }
+
+    // Batched lookups, with hits and misses (and repeats) in the same batch
+    {
+      RouteCache cache { 256 };
+      vector<uint32_t> addresses( 100 );
+      vector<const Route*> routes( addresses.size() );
+      for ( size_t round = 0; round < 20; ++round ) {
+        for ( auto& address : addresses ) {
+          address = 0x0a010000 | ( rd() & 0x1ff );
+        }
+        cache.lookup( table, addresses, routes );
+        for ( size_t i = 0; i < addresses.size(); ++i ) {
+          test_should_be( interface_num( routes[i] ), interface_num( table.lookup( addresses[i] ) ) );
+        }
+      }
+      test_should_be( cache.hits() + cache.misses(), uint64_t { 2000 } );
+      if ( cache.hits() == 0 ) {
+        throw runtime_error( "RouteCache never hit" );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
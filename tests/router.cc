@@ -153,7 +153,7 @@ private:
   {
     while ( optional<EthernetFrame> frame = src.maybe_send() ) {
       cerr << "Transferring frame from " << src_name << " to " << dst_name << ": " << summary( *frame ) << "\n";
-      dst.recv_frame( *frame );
+      dst.recv_frame( std::move( *frame ) );
     }
   }
 
@@ -227,6 +227,11 @@ public:
     }
   }
 
+  bool remove_route( const string& prefix, const uint8_t prefix_length )
+  {
+    return _router.remove_route( ip( prefix ), prefix_length );
+  }
+
   Host& host( const string& name )
   {
     auto it = _hosts.find( name );
@@ -305,6 +310,25 @@ void network_simulator()
     network.simulate();
   }
 
+  cout << green << "\n\nSuccess! Testing removal of a route (143.195.192.0/19)..." << normal << "\n\n";
+  {
+    if ( not network.remove_route( "143.195.192.0", 19 ) or network.remove_route( "143.195.192.0", 19 ) ) {
+      throw runtime_error( "remove_route did not report removing the route exactly once" );
+    }
+
+    auto dgram_sent = network.host( "cherrypie" ).send_to( Address { "143.195.193.52" } );
+    dgram_sent.header.ttl--;
+    dgram_sent.header.compute_checksum();
+    network.host( "default_router" ).expect( dgram_sent );
+    network.simulate();
+
+    dgram_sent = network.host( "cherrypie" ).send_to( Address { "143.195.131.17" } );
+    dgram_sent.header.ttl--;
+    dgram_sent.header.compute_checksum();
+    network.host( "hs_router" ).expect( dgram_sent );
+    network.simulate();
+  }
+
   cout << green << "\n\nSuccess! Testing two hosts on the same network (dm42 to dm43)..." << normal << "\n\n";
   {
     auto dgram_sent = network.host( "dm42" ).send_to( network.host( "dm43" ).address() );
@@ -0,0 +1,93 @@
+#include "star_topology.hh"
+#include "test_should_be.hh"
+
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    // Every datagram arrives, in order within its flow, whatever the number of workers
+    for ( const size_t num_workers : { 1, 2, 3, 5 } ) {
+      StarTopology topology { 6 };
+      topology.offer( 2000, 60 );
+      topology.router().route_parallel( num_workers );
+      test_should_be( topology.collect(), size_t { 2000 } );
+
+      // ... and the router can keep going, in parallel or not
+      topology.offer( 500, 60 );
+      topology.router().route();
+      test_should_be( topology.collect(), size_t { 500 } );
+
+      topology.offer( 1000, 7 );
+      topology.router().route_parallel( num_workers );
+      test_should_be( topology.collect(), size_t { 1000 } );
+    }
+
+    // With a route cache, in parallel and not, and across a route change
+    {
+      StarTopology topology { 4 };
+      Router& router = topology.router();
+      router.enable_route_cache( 64 );
+
+      topology.offer( 1000, 12 );
+      router.route_parallel( 2 );
+      test_should_be( topology.collect(), size_t { 1000 } );
+
+      topology.offer( 500, 12 );
+      router.route();
+      test_should_be( topology.collect(), size_t { 500 } );
+      test_should_be( router.route_cache_hits() + router.route_cache_misses(), uint64_t { 1500 } );
+      if ( router.route_cache_hits() < 1200 ) {
+        throw runtime_error( "route cache hit only " + to_string( router.route_cache_hits() ) + " times" );
+      }
+
+      // Replacing a route empties the cache, so the new route takes effect
+      router.add_route( 0x0a000300, 24, {}, 3 );
+      const uint64_t misses = router.route_cache_misses();
+      topology.offer( 500, 12 );
+      router.route();
+      test_should_be( topology.collect(), size_t { 500 } );
+      if ( router.route_cache_misses() == misses ) {
+        throw runtime_error( "route cache was not invalidated by a route change" );
+      }
+    }
+
+    // A replaced forwarding table is freed without waiting for more traffic or more route changes
+    {
+      StarTopology topology { 2 };
+      Router& router = topology.router();
+      topology.offer( 100, 4 );
+      router.route();
+      test_should_be( topology.collect(), size_t { 100 } );
+
+      router.publish_routes();
+      test_should_be( router.retired_forwarding_tables(), size_t { 0 } );
+
+      router.add_route( 0x0a000300, 24, {}, 1 );
+      router.route(); // Publishes the change
+      test_should_be( router.retired_forwarding_tables(), size_t { 0 } );
+
+      router.route_parallel( 2 );
+      router.publish_routes();
+      test_should_be( router.retired_forwarding_tables(), size_t { 0 } );
+    }
+
+    // Nothing to route
+    {
+      StarTopology topology { 2 };
+      topology.router().route_parallel( 4 );
+      test_should_be( topology.collect(), size_t { 0 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
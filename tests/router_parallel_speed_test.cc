@@ -0,0 +1,66 @@
+#include "star_topology.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+using namespace std::chrono;
+
+double speed_test( const size_t num_workers, const size_t num_interfaces, const size_t num_datagrams )
+{
+  StarTopology topology { num_interfaces };
+  topology.offer( num_datagrams, 4096 );
+
+  const auto start_time = steady_clock::now();
+  topology.router().route_parallel( num_workers );
+  const auto stop_time = steady_clock::now();
+
+  if ( topology.collect() != num_datagrams ) {
+    throw runtime_error( "Router did not deliver every datagram" );
+  }
+
+  const auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  return static_cast<double>( num_datagrams ) / test_duration.count();
+}
+
+void program_body()
+{
+  constexpr size_t NUM_INTERFACES = 16;
+  constexpr size_t NUM_DATAGRAMS = 200'000;
+
+  // Up to one worker per core, but at least two workers so the parallel path is always exercised
+  const size_t max_workers = max( size_t { 2 }, min( size_t { thread::hardware_concurrency() }, NUM_INTERFACES ) );
+
+  double single_worker_rate = 0;
+  for ( size_t num_workers = 1; num_workers <= max_workers; num_workers *= 2 ) {
+    const double datagrams_per_second = speed_test( num_workers, NUM_INTERFACES, NUM_DATAGRAMS );
+    if ( num_workers == 1 ) {
+      single_worker_rate = datagrams_per_second;
+    }
+
+    cout << "Router with " << NUM_INTERFACES << " interfaces, " << setw( 2 ) << num_workers << " worker"
+         << ( num_workers == 1 ? ": " : "s:" ) << fixed << setprecision( 2 ) << setw( 7 )
+         << datagrams_per_second / 1e6 << " million datagrams/s (" << datagrams_per_second / single_worker_rate
+         << "x one worker, " << thread::hardware_concurrency() << " cores available)\n";
+
+    if ( datagrams_per_second < 1e4 ) {
+      throw runtime_error( "Router did not meet minimum speed of 10,000 datagrams/s" );
+    }
+  }
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,208 @@
+#include "forwarding_table.hh"
+#include "route_cache.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+// Roughly the shape of a full Internet routing table: mostly /24s, then /22-/23s, a spread of
+// shorter prefixes, and a few more-specific ones.
+RoutingTable full_table( const size_t num_routes, default_random_engine& rd )
+{
+  discrete_distribution<int> length_distribution {
+    0, 0, 0, 0, 0, 0, 0, 0, 16, 12, 37, 99, 320, 570, 1000, 1800,  //  /0 - /15
+    13200, 7600, 13500, 24400, 43400, 51000, 112000, 94000, 535000, //  /16 - /24
+    100, 100, 100, 200, 300, 400, 500, 1500                         //  /25 - /32
+  };
+
+  RoutingTable routing_table;
+  size_t num_added = 0;
+  while ( num_added < num_routes ) {
+    const auto prefix_length = static_cast<uint8_t>( length_distribution( rd ) );
+    // A next hop of its own, so that check() can tell every route apart
+    const Route route { static_cast<uint32_t>( num_added + 1 ), static_cast<uint32_t>( num_added % 64 ) };
+    const auto [it, inserted]
+      = routing_table.at( prefix_length ).try_emplace( prefix_of( rd(), prefix_length ), route );
+    num_added += inserted;
+  }
+  return routing_table;
+}
+
+// Check the ForwardingTable against a lookup done the slow way, one prefix length at a time: each
+// lookup must find the same route (which its unique next hop identifies), not just the same interface.
+void check( const RoutingTable& routing_table, const ForwardingTable& table, const vector<uint32_t>& addresses )
+{
+  for ( size_t i = 0; i < addresses.size(); i += 97 ) {
+    const Route* expected = nullptr;
+    for ( int prefix_length = 32; prefix_length >= 0 and not expected; --prefix_length ) {
+      const auto& routes = routing_table.at( prefix_length );
+      const auto it = routes.find( prefix_of( addresses[i], prefix_length ) );
+      if ( it != routes.end() ) {
+        expected = &it->second;
+      }
+    }
+    const Route* actual = table.lookup( addresses[i] );
+    const bool same_route = expected and actual and expected->next_hop == actual->next_hop
+                            and expected->interface_num == actual->interface_num;
+    if ( not same_route and ( expected or actual ) ) {
+      throw runtime_error( "ForwardingTable lookup does not match the routing table" );
+    }
+  }
+}
+
+void speed_test( const string& workload,
+                 const ForwardingTable& table,
+                 const vector<uint32_t>& addresses,
+                 const size_t batch_size )
+{
+  size_t checksum = 0;
+  vector<const Route*> routes( batch_size );
+  const auto start_time = steady_clock::now();
+  if ( batch_size == 1 ) {
+    for ( const uint32_t address : addresses ) {
+      const Route* route = table.lookup( address );
+      checksum += route ? route->interface_num : 0;
+    }
+  } else {
+    for ( size_t first = 0; first < addresses.size(); first += batch_size ) {
+      const size_t len = min( batch_size, addresses.size() - first );
+      table.lookup( span { addresses }.subspan( first, len ), routes );
+      for ( size_t i = 0; i < len; ++i ) {
+        checksum += routes[i] ? routes[i]->interface_num : 0;
+      }
+    }
+  }
+  const auto stop_time = steady_clock::now();
+
+  const auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  const double lookups_per_second = static_cast<double>( addresses.size() ) / test_duration.count();
+
+  cout << "ForwardingTable with " << table.size() << " routes, " << left << setw( 24 ) << workload + ","
+       << " batch=" << setw( 4 ) << batch_size << right << fixed << setprecision( 2 ) << setw( 7 )
+       << lookups_per_second / 1e6 << " million lookups/s (checksum " << checksum << ")\n";
+
+  if ( lookups_per_second < 1e6 ) {
+    throw runtime_error( "ForwardingTable did not meet minimum speed of 1 million lookups/s (" + workload + ")" );
+  }
+}
+
+// The same lookups, in batches of 32, through a RouteCache of `cache_entries` entries
+void cache_speed_test( const string& workload,
+                       const ForwardingTable& table,
+                       const vector<uint32_t>& addresses,
+                       const size_t cache_entries )
+{
+  constexpr size_t BATCH_SIZE = 32;
+  RouteCache cache { cache_entries };
+  size_t checksum = 0;
+  vector<const Route*> routes( BATCH_SIZE );
+  const auto start_time = steady_clock::now();
+  for ( size_t first = 0; first < addresses.size(); first += BATCH_SIZE ) {
+    const size_t len = min( BATCH_SIZE, addresses.size() - first );
+    cache.lookup( table, span { addresses }.subspan( first, len ), span { routes }.first( len ) );
+    for ( size_t i = 0; i < len; ++i ) {
+      checksum += routes[i] ? routes[i]->interface_num : 0;
+    }
+  }
+  const auto stop_time = steady_clock::now();
+
+  const auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  const double lookups_per_second = static_cast<double>( addresses.size() ) / test_duration.count();
+  const double hit_rate = static_cast<double>( cache.hits() ) / static_cast<double>( addresses.size() );
+
+  cout << "RouteCache with " << setw( 6 ) << cache.size() << " entries, " << left << setw( 24 ) << workload + ","
+       << " batch=" << setw( 4 ) << BATCH_SIZE << right << fixed << setprecision( 2 ) << setw( 7 )
+       << lookups_per_second / 1e6 << " million lookups/s, " << setw( 6 ) << hit_rate * 100
+       << "% hits (checksum " << checksum << ")\n";
+
+  if ( cache.hits() + cache.misses() != addresses.size() ) {
+    throw runtime_error( "RouteCache hits and misses do not add up to the lookups" );
+  }
+  if ( lookups_per_second < 1e6 ) {
+    throw runtime_error( "RouteCache did not meet minimum speed of 1 million lookups/s (" + workload + ")" );
+  }
+}
+
+void program_body()
+{
+  default_random_engine rd { 1370 };
+  constexpr size_t NUM_ROUTES = 900'000;
+  constexpr size_t NUM_LOOKUPS = 10'000'000;
+
+  const RoutingTable routing_table = full_table( NUM_ROUTES, rd );
+
+  const auto start_time = steady_clock::now();
+  const ForwardingTable table { routing_table };
+  const auto build_duration = duration_cast<duration<double>>( steady_clock::now() - start_time );
+  cout << "ForwardingTable with " << table.size() << " routes built in " << fixed << setprecision( 3 )
+       << build_duration.count() << " s, using " << table.memory_usage() / 1'000'000 << " MB\n";
+
+  // Destinations drawn uniformly from the whole address space
+  vector<uint32_t> random_addresses( NUM_LOOKUPS );
+  for ( auto& address : random_addresses ) {
+    address = rd();
+  }
+
+  // Destinations inside the table's prefixes, as traffic through a default-free router would be
+  vector<uint32_t> prefixes;
+  for ( size_t prefix_length = 8; prefix_length < routing_table.size(); ++prefix_length ) {
+    for ( const auto& [prefix, route] : routing_table.at( prefix_length ) ) {
+      prefixes.push_back( prefix );
+    }
+  }
+  vector<uint32_t> routed_addresses( NUM_LOOKUPS );
+  uniform_int_distribution<size_t> pick { 0, prefixes.size() - 1 };
+  for ( auto& address : routed_addresses ) {
+    address = prefixes[pick( rd )] | ( rd() & 0xff );
+  }
+
+  // Destinations concentrated on a few popular hosts, as in most real traffic: 90% of the datagrams
+  // go to one of 2,000 destinations, and the rest are spread over the table.
+  vector<uint32_t> popular_addresses( NUM_LOOKUPS );
+  vector<uint32_t> popular( 2000 );
+  for ( auto& address : popular ) {
+    address = prefixes[pick( rd )] | ( rd() & 0xff );
+  }
+  uniform_int_distribution<size_t> pick_popular { 0, popular.size() - 1 };
+  bernoulli_distribution is_popular { 0.9 };
+  for ( auto& address : popular_addresses ) {
+    address = is_popular( rd ) ? popular[pick_popular( rd )] : prefixes[pick( rd )] | ( rd() & 0xff );
+  }
+
+  check( routing_table, table, random_addresses );
+  check( routing_table, table, routed_addresses );
+  check( routing_table, table, popular_addresses );
+
+  for ( const size_t batch_size : { 1, 8, 32, 256 } ) {
+    speed_test( "random addresses", table, random_addresses, batch_size );
+    speed_test( "addresses in table", table, routed_addresses, batch_size );
+  }
+
+  speed_test( "popular addresses", table, popular_addresses, 32 );
+  for ( const size_t cache_entries : { 1024, 8192 } ) {
+    cache_speed_test( "addresses in table", table, routed_addresses, cache_entries );
+    cache_speed_test( "popular addresses", table, popular_addresses, cache_entries );
+  }
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
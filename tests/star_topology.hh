@@ -0,0 +1,144 @@
+#pragma once
+
+#include "ethernet_frame.hh"
+#include "ipv4_datagram.hh"
+#include "parser.hh"
+#include "router.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A router with one host on each of its interfaces: interface i is 10.0.i.1 on 10.0.i.0/24, and its
+// host is 10.0.i.2. The traffic is a set of UDP flows between the hosts, each datagram carrying its
+// flow's sequence number, so that the receiving side can check that no flow was reordered.
+class StarTopology
+{
+  Router router_ {};
+  std::vector<AsyncNetworkInterface> hosts_ {};
+  std::vector<uint64_t> sent_ {};     // Datagrams offered so far, per flow
+  std::vector<uint64_t> received_ {}; // Datagrams collected so far, per flow
+
+  static EthernetAddress ethernet_address( const size_t interface_num, const bool is_router )
+  {
+    return { 0x02, 0, 0, is_router, 0, static_cast<uint8_t>( interface_num ) };
+  }
+
+  static uint32_t ip( const size_t interface_num, const uint8_t host )
+  {
+    return 10U << 24 | static_cast<uint32_t>( interface_num ) << 8 | host;
+  }
+
+  size_t source_of( const size_t flow ) const { return flow % hosts_.size(); }
+
+  size_t destination_of( const size_t flow ) const
+  {
+    const size_t n = hosts_.size();
+    return ( source_of( flow ) + 1 + ( flow / n ) % ( n - 1 ) ) % n;
+  }
+
+public:
+  explicit StarTopology( const size_t num_interfaces )
+  {
+    if ( num_interfaces < 2 ) {
+      throw std::runtime_error( "StarTopology needs at least two interfaces" );
+    }
+
+    for ( size_t i = 0; i < num_interfaces; ++i ) {
+      router_.add_interface(
+        AsyncNetworkInterface { ethernet_address( i, true ), Address::from_ipv4_numeric( ip( i, 1 ) ) } );
+      hosts_.emplace_back( ethernet_address( i, false ), Address::from_ipv4_numeric( ip( i, 2 ) ) );
+      router_.add_route( ip( i, 0 ), 24, {}, i );
+    }
+
+    // Teach the router each host's Ethernet address, with an ARP request from the host.
+    for ( size_t i = 0; i < num_interfaces; ++i ) {
+      hosts_[i].send_datagram( InternetDatagram {}, Address::from_ipv4_numeric( ip( i, 1 ) ) );
+      while ( auto frame = hosts_[i].maybe_send() ) {
+        router_.interface( i ).recv_frame( std::move( *frame ) );
+      }
+      while ( router_.interface( i ).maybe_send() ) {}
+    }
+  }
+
+  Router& router() { return router_; }
+
+  // Have `count` datagrams arrive at the router, spread round-robin over `num_flows` flows.
+  void offer( const size_t count, const size_t num_flows )
+  {
+    sent_.resize( std::max( sent_.size(), num_flows ) );
+    received_.resize( sent_.size() );
+
+    for ( size_t i = 0; i < count; ++i ) {
+      const size_t flow = i % num_flows;
+      const size_t source = source_of( flow );
+
+      std::string payload( sizeof( uint32_t ) + sizeof( uint64_t ), 0 );
+      const auto ports = static_cast<uint32_t>( flow );
+      memcpy( payload.data(), &ports, sizeof( ports ) );
+      memcpy( payload.data() + sizeof( ports ), &sent_[flow], sizeof( uint64_t ) );
+      ++sent_[flow];
+
+      InternetDatagram dgram;
+      dgram.header.proto = 17;
+      dgram.header.src = ip( source, 2 );
+      dgram.header.dst = ip( destination_of( flow ), 2 );
+      dgram.header.len = static_cast<uint16_t>( dgram.header.hlen * 4 + payload.size() );
+      dgram.header.ttl = 64;
+      dgram.header.compute_checksum();
+      dgram.payload.emplace_back( std::move( payload ) );
+
+      EthernetFrame frame;
+      frame.header.dst = ethernet_address( source, true );
+      frame.header.src = ethernet_address( source, false );
+      frame.header.type = EthernetHeader::TYPE_IPv4;
+      // In one contiguous Buffer, as read from a device
+      std::string bytes;
+      for ( const auto& buffer : serialize( dgram ) ) {
+        bytes += std::string_view { buffer };
+      }
+      frame.payload.emplace_back( std::move( bytes ) );
+      router_.interface( source ).recv_frame( std::move( frame ) );
+    }
+  }
+
+  // Take every frame the router has sent, and check that each went to the right host, in order
+  // within its flow. Returns the number of frames.
+  size_t collect()
+  {
+    size_t count = 0;
+    for ( size_t i = 0; i < hosts_.size(); ++i ) {
+      while ( auto frame = router_.interface( i ).maybe_send() ) {
+        InternetDatagram dgram;
+        if ( frame->header.dst != ethernet_address( i, false ) or not parse( dgram, frame->payload )
+             or dgram.header.payload_length() != sizeof( uint32_t ) + sizeof( uint64_t ) ) {
+          throw std::runtime_error( "router sent an unexpected frame on interface " + std::to_string( i ) );
+        }
+
+        std::string payload;
+        for ( const auto& buffer : dgram.payload ) {
+          payload += std::string_view { buffer };
+        }
+        uint32_t flow {};
+        uint64_t sequence {};
+        memcpy( &flow, payload.data(), sizeof( flow ) );
+        memcpy( &sequence, payload.data() + sizeof( flow ), sizeof( sequence ) );
+        if ( dgram.header.dst != ip( i, 2 ) or destination_of( flow ) != i ) {
+          throw std::runtime_error( "router sent a datagram out the wrong interface" );
+        }
+        if ( sequence != received_.at( flow ) ) {
+          throw std::runtime_error( "flow " + std::to_string( flow ) + " was reordered: expected datagram "
+                                    + std::to_string( received_.at( flow ) ) + ", got "
+                                    + std::to_string( sequence ) );
+        }
+        ++received_.at( flow );
+        ++count;
+      }
+    }
+    return count;
+  }
+};
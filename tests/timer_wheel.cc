@@ -0,0 +1,99 @@
+#include "random.hh"
+#include "test_should_be.hh"
+#include "timer_wheel.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    // Timers fire in order of deadline, once their deadline has passed
+    {
+      TimerWheel<int> wheel;
+      wheel.schedule( 100, 1 );
+      wheel.schedule( 5, 2 );
+      wheel.schedule( 70'000, 3 );
+      wheel.schedule( 64, 4 );
+      test_should_be( wheel.size(), size_t { 4 } );
+
+      vector<int> fired;
+      const auto fire = [&]( uint64_t, int value ) { fired.push_back( value ); };
+      wheel.advance( 4, fire );
+      test_should_be( fired.size(), size_t { 0 } );
+      wheel.advance( 64, fire );
+      test_should_be( fired.size(), size_t { 2 } );
+      test_should_be( fired.at( 0 ), 2 );
+      test_should_be( fired.at( 1 ), 4 );
+      wheel.advance( 69'999, fire );
+      test_should_be( fired.size(), size_t { 3 } );
+      wheel.advance( 70'000, fire );
+      test_should_be( fired.size(), size_t { 4 } );
+      test_should_be( fired.at( 3 ), 3 );
+      test_should_be( wheel.size(), size_t { 0 } );
+      test_should_be( wheel.now(), uint64_t { 70'000 } );
+
+      // A deadline already passed fires at the next advance
+      wheel.schedule( 10, 5 );
+      wheel.advance( 70'001, fire );
+      test_should_be( fired.size(), size_t { 5 } );
+    }
+
+    // Deadlines past the horizon are brought in to it
+    {
+      TimerWheel<int> wheel { 12345 };
+      uint64_t fired_at = 0;
+      wheel.schedule( UINT64_MAX, 1 );
+      wheel.advance( UINT64_MAX, [&]( uint64_t deadline, int ) { fired_at = deadline; } );
+      test_should_be( fired_at, 12345 + TimerWheel<int>::HORIZON );
+    }
+
+    // Random timers, some scheduled from inside `fire`, and random steps of time, small and large
+    {
+      TimerWheel<uint64_t> wheel;
+      multimap<uint64_t, uint64_t> reference;
+      uint64_t next_id = 0;
+      geometric_distribution<uint64_t> delay_dist { 0.0001 };
+      geometric_distribution<uint64_t> step_dist { 0.001 };
+
+      const auto add = [&]( uint64_t deadline ) {
+        wheel.schedule( deadline, next_id );
+        reference.emplace( deadline, next_id++ );
+      };
+
+      for ( size_t round = 0; round < 20'000; ++round ) {
+        add( wheel.now() + 1 + delay_dist( rd ) );
+        if ( round % 1000 == 0 ) {
+          add( wheel.now() + TimerWheel<uint64_t>::HORIZON - round );
+        }
+
+        const uint64_t time = wheel.now() + ( round % 500 == 0 ? 1'000'000 : step_dist( rd ) );
+        wheel.advance( time, [&]( uint64_t deadline, uint64_t id ) {
+          const auto it = reference.begin();
+          test_should_be( it == reference.end(), false );
+          test_should_be( deadline, it->first );
+          test_should_be( deadline <= time, true );
+          reference.erase( it );
+          if ( id % 7 == 0 ) {
+            add( deadline + 1 + id % 1000 );
+          }
+        } );
+        test_should_be( reference.empty() or reference.begin()->first > time, true );
+        test_should_be( wheel.size(), reference.size() );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
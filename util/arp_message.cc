@@ -69,14 +69,10 @@ void ARPMessage::serialize( Serializer& serializer ) const
   serializer.integer( opcode );
 
   // read sender addresses (Ethernet and IP)
-  for ( const auto& b : sender_ethernet_address ) {
-    serializer.integer( b );
-  }
+  serializer.string( bytes_of( sender_ethernet_address ) );
   serializer.integer( sender_ip_address );
 
   // read target addresses (Ethernet and IP)
-  for ( const auto& b : target_ethernet_address ) {
-    serializer.integer( b );
-  }
+  serializer.string( bytes_of( target_ethernet_address ) );
   serializer.integer( target_ip_address );
 }
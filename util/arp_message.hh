@@ -12,6 +12,8 @@ struct ARPMessage
   static constexpr uint16_t OPCODE_REQUEST = 1;
   static constexpr uint16_t OPCODE_REPLY = 2;
 
+  static constexpr uint64_t serialized_length() { return LENGTH; }
+
   uint16_t hardware_type = TYPE_ETHERNET;             // Type of the link-layer protocol (generally Ethernet/Wi-Fi)
   uint16_t protocol_type = EthernetHeader::TYPE_IPv4; // Type of the Internet-layer protocol (generally IPv4)
   uint8_t hardware_address_size = sizeof( EthernetHeader::src );
@@ -1,23 +1,309 @@
 #pragma once
 
-#include <memory>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
-class Buffer
+// A shared, immutable-by-convention string of bytes, cheap to copy.
+//
+// Like a Linux skb or BSD mbuf, a Buffer can be a view of the end of its storage: the bytes before
+// it are its headroom. A parser that consumes a header from the front of a Buffer (remove_prefix())
+// turns that header into headroom, and a serializer can later write a new header there (prepend())
+// without copying the bytes that follow, as long as nothing else shares the storage.
+//
+// The storage is a node holding a reference count and a std::string. Nodes come from a pool kept by
+// each thread: a node whose last Buffer is gone goes back to the pool of the thread that let it go,
+// keeping its string's memory, so that a Buffer that later allocates its own bytes on that thread
+// (with_headroom(), or writing to an empty Buffer) can reuse both. A Buffer made from a string keeps
+// the string's memory instead, rather than copying the bytes into the pool's. The pool sorts nodes
+// into size classes by that memory, so that a node with room for a full-sized frame is not handed
+// out for a header. An empty Buffer (default-constructed, or moved from) has no node.
+//
+// Buffer (ATOMIC = false) counts references with plain increments and decrements, so a Buffer and
+// its copies must be used by only one thread at a time; moving a Buffer to another thread is fine,
+// as long as it has no copies left behind (see unshare()). SharedBuffer (ATOMIC = true) counts them
+// atomically, for copies that are used by several threads at once.
+template<bool ATOMIC>
+class BasicBuffer
 {
-  std::shared_ptr<std::string> buffer_;
+  using RefCount = std::conditional_t<ATOMIC, std::atomic<uint32_t>, uint32_t>;
+
+  struct Node
+  {
+    RefCount refs { 1 };
+    std::string data {};
+  };
+
+  // Size classes, by the capacity of a node's string
+  static constexpr size_t HEADER_CAPACITY = 128; // Headers, ARP messages and other small payloads
+  static constexpr size_t FRAME_CAPACITY = 2048; // Up to an Ethernet MTU, with room to spare
+  static constexpr size_t MAX_FREE_NODES = 1024; // Per size class, beyond which nodes are deleted
+
+  static size_t size_class( const size_t capacity ) { return capacity <= HEADER_CAPACITY ? 0 : 1; }
+
+  // The nodes that this thread has let go of, for reuse
+  class Pool
+  {
+    std::array<std::vector<Node*>, 2> free_ {};
+
+  public:
+    Pool() = default;
+    Pool( const Pool& ) = delete;
+    Pool& operator=( const Pool& ) = delete;
+
+    ~Pool()
+    {
+      pool_closed_ = true;
+      for ( auto& nodes : free_ ) {
+        for ( Node* node : nodes ) {
+          delete node;
+        }
+      }
+    }
+
+    // A node from the size class for `capacity` bytes, whose string may have less room than that
+    Node* take( const size_t capacity )
+    {
+      auto& nodes = free_[size_class( capacity )];
+      if ( nodes.empty() ) {
+        return new Node;
+      }
+      Node* node = nodes.back();
+      nodes.pop_back();
+      node->refs = 1;
+      return node;
+    }
+
+    void release( Node* node )
+    {
+      node->data.clear();
+      if ( node->data.capacity() > FRAME_CAPACITY ) {
+        std::string {}.swap( node->data ); // Too big to keep around
+      }
+      auto& nodes = free_[size_class( node->data.capacity() )];
+      if ( nodes.size() >= MAX_FREE_NODES ) {
+        delete node;
+        return;
+      }
+      nodes.push_back( node );
+    }
+  };
+
+  Node* node_ {};
+  size_t offset_ {}; // Bytes of the storage before the start of this Buffer (its headroom)
+
+  static inline thread_local uint64_t copies_ {};  // See copies()
+  static inline thread_local bool pool_closed_ {}; // Set once this thread's pool is destroyed
+
+  BasicBuffer( Node* node, size_t offset ) : node_( node ), offset_( offset ) {}
+
+  static Pool& pool()
+  {
+    static thread_local Pool thread_pool;
+    return thread_pool;
+  }
+
+  static Node* take( const size_t capacity ) { return pool_closed_ ? new Node : pool().take( capacity ); }
+
+  // A node whose string has room for at least `capacity` bytes (without reallocating)
+  static Node* acquire( const size_t capacity )
+  {
+    Node* node = take( capacity );
+    node->data.reserve( capacity );
+    return node;
+  }
+
+  static void ref( Node* node )
+  {
+    if ( node == nullptr ) {
+      return;
+    }
+    if constexpr ( ATOMIC ) {
+      node->refs.fetch_add( 1, std::memory_order_relaxed );
+    } else {
+      ++node->refs;
+    }
+  }
+
+  static void unref( Node* node )
+  {
+    if ( node == nullptr ) {
+      return;
+    }
+    bool last = false;
+    if constexpr ( ATOMIC ) {
+      last = node->refs.fetch_sub( 1, std::memory_order_acq_rel ) == 1;
+    } else {
+      last = --node->refs == 0;
+    }
+    if ( not last ) {
+      return;
+    }
+    if ( pool_closed_ ) {
+      delete node;
+    } else {
+      pool().release( node );
+    }
+  }
+
+  // Replace the storage with a node of this thread's own, with the same bytes and `headroom` bytes
+  // of headroom
+  void copy_storage( const size_t headroom )
+  {
+    const std::string_view bytes { *this };
+    Node* node = acquire( headroom + bytes.size() );
+    node->data.resize( headroom );
+    node->data.append( bytes );
+    unref( node_ );
+    node_ = node;
+    offset_ = headroom;
+  }
+
+  // Give up the headroom, so that the storage holds exactly this Buffer's bytes. Copies them out of
+  // the storage if there was headroom, so as not to disturb other Buffers that share it.
+  void drop_headroom()
+  {
+    if ( offset_ != 0 ) {
+      copy_storage( 0 );
+    }
+  }
+
+  // The string holding exactly this Buffer's bytes, taking a node for it if there is none
+  std::string& data()
+  {
+    if ( node_ == nullptr ) {
+      node_ = acquire( 0 );
+    }
+    drop_headroom();
+    return node_->data;
+  }
 
 public:
   // NOLINTBEGIN(*-explicit-*)
 
-  Buffer( std::string str = {} ) : buffer_( make_shared<std::string>( std::move( str ) ) ) {}
-  operator std::string_view() const { return *buffer_; }
-  operator std::string&() { return *buffer_; }
+  BasicBuffer() = default;
+  BasicBuffer( std::string str )
+  {
+    if ( str.empty() ) {
+      return;
+    }
+    // The string's memory becomes the storage, without copying its bytes. Only the node comes from the
+    // pool: the memory kept for it (a header's worth, at most) gives way to the string's.
+    node_ = take( 0 );
+    node_->data = std::move( str );
+  }
+  operator std::string_view() const
+  {
+    return node_ == nullptr ? std::string_view {} : std::string_view { node_->data }.substr( offset_ );
+  }
+  operator std::string&() { return data(); }
 
   // NOLINTEND(*-explicit-*)
 
-  std::string&& release() { return std::move( *buffer_ ); }
-  size_t size() const { return buffer_->size(); }
-  size_t length() const { return buffer_->length(); }
-  bool empty() const { return buffer_->empty(); }
+  // A copy shares the storage, taking a reference to it
+  BasicBuffer( const BasicBuffer& other ) : node_( other.node_ ), offset_( other.offset_ )
+  {
+    ref( node_ );
+    ++copies_;
+  }
+  BasicBuffer& operator=( const BasicBuffer& other )
+  {
+    if ( this != &other ) {
+      ref( other.node_ );
+      unref( node_ );
+      node_ = other.node_;
+      offset_ = other.offset_;
+      ++copies_;
+    }
+    return *this;
+  }
+  BasicBuffer( BasicBuffer&& other ) noexcept
+    : node_( std::exchange( other.node_, nullptr ) ), offset_( std::exchange( other.offset_, 0 ) )
+  {}
+  BasicBuffer& operator=( BasicBuffer&& other ) noexcept
+  {
+    if ( this != &other ) {
+      unref( node_ );
+      node_ = std::exchange( other.node_, nullptr );
+      offset_ = std::exchange( other.offset_, 0 );
+    }
+    return *this;
+  }
+  ~BasicBuffer() { unref( node_ ); }
+
+  // Buffers copied (and so references taken to shared storage) by this thread so far, to measure
+  // how many a code path makes
+  static uint64_t copies() { return copies_; }
+
+  // A Buffer of `data`, with `headroom` bytes reserved in front of it (and `tailroom` after it)
+  static BasicBuffer with_headroom( std::string_view data, size_t headroom, size_t tailroom = 0 )
+  {
+    Node* node = acquire( headroom + data.size() + tailroom );
+    node->data.resize( headroom );
+    node->data.append( data );
+    return { node, headroom };
+  }
+
+  std::string&& release() { return std::move( data() ); }
+  size_t size() const { return node_ == nullptr ? 0 : node_->data.size() - offset_; }
+  size_t length() const { return size(); }
+  bool empty() const { return size() == 0; }
+
+  // Number of Buffers sharing the storage, this one included (0 for an empty Buffer without any)
+  uint32_t use_count() const
+  {
+    if ( node_ == nullptr ) {
+      return 0;
+    }
+    if constexpr ( ATOMIC ) {
+      return node_->refs.load( std::memory_order_acquire );
+    } else {
+      return node_->refs;
+    }
+  }
+
+  // Give this Buffer storage of its own (keeping its headroom), if it shares it with others
+  void unshare()
+  {
+    if ( use_count() > 1 ) {
+      copy_storage( offset_ );
+    }
+  }
+
+  // Bytes in front of this Buffer that prepend() can take over
+  size_t headroom() const { return offset_; }
+
+  // Whether prepend( n ) can be done in place: there is enough headroom, and nothing else shares the
+  // storage (and so could be looking at, or writing, the same headroom)
+  bool can_prepend( size_t n ) const { return offset_ >= n and use_count() == 1; }
+
+  // Drop the first `n` bytes, keeping them as headroom
+  void remove_prefix( size_t n )
+  {
+    if ( n > size() ) {
+      throw std::out_of_range( "Buffer::remove_prefix past the end" );
+    }
+    offset_ += n;
+  }
+
+  // Extend this Buffer to include the `n` bytes of headroom in front of it, and return them to be
+  // written. Requires can_prepend( n ).
+  std::span<char> prepend( size_t n )
+  {
+    if ( not can_prepend( n ) ) {
+      throw std::runtime_error( "Buffer::prepend without enough unshared headroom" );
+    }
+    offset_ -= n;
+    return { node_->data.data() + offset_, n };
+  }
 };
+
+using Buffer = BasicBuffer<false>;
+using SharedBuffer = BasicBuffer<true>;
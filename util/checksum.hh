@@ -2,46 +2,141 @@
 
 #include "buffer.hh"
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#if defined( __SSE2__ )
+#include <emmintrin.h>
+#endif
+
 //! The internet checksum algorithm
+//!
+//! The ones'-complement sum does not depend on byte order (RFC 1071), so the bulk of the data is
+//! summed a machine word (or an SSE2 vector, which every x86-64 build has) at a time in native
+//! order, and only the folded result is swapped into network order. Data may arrive in chunks of any
+//! length: a chunk that ends on an odd byte leaves `parity_` set, and the next chunk's first byte
+//! completes that 16-bit word.
 class InternetChecksum
 {
 private:
-  uint32_t sum_;
+  uint64_t sum_;
   bool parity_ {};
 
-public:
-  explicit InternetChecksum( const uint32_t sum = 0 ) : sum_( sum ) {}
-  void add( std::string_view data )
+  // Fold a wide sum down to 16 bits with end-around carry.
+  static uint16_t fold( uint64_t sum )
+  {
+    while ( sum > 0xffff ) {
+      sum = ( sum >> 16 ) + ( sum & 0xffff );
+    }
+    return static_cast<uint16_t>( sum );
+  }
+
+  // Convert a folded sum of native-order 16-bit words into the sum of the same words in network order.
+  static uint16_t to_network_order( const uint16_t sum )
   {
-    for ( const uint8_t i : data ) {
-      uint16_t val = i;
-      if ( not parity_ ) {
-        val <<= 8;
+    if constexpr ( std::endian::native == std::endian::little ) {
+      return std::rotl( sum, 8 );
+    }
+    return sum;
+  }
+
+  // Sum `len` bytes (`len` must be even) as 16-bit words in native byte order.
+  static uint64_t sum_native( const char* data, const size_t len )
+  {
+    uint64_t sum = 0;
+    size_t i = 0;
+
+#if defined( __SSE2__ )
+    // Widen each 16-bit word into a 32-bit lane and accumulate; each iteration adds at most 0x1fffe
+    // to a lane, so flush the lanes into `sum` before they could overflow.
+    constexpr size_t MAX_ITERATIONS = 16384;
+    constexpr size_t VECTOR_SIZE = sizeof( __m128i );
+    while ( len - i >= VECTOR_SIZE ) {
+      const size_t iterations = std::min( ( len - i ) / VECTOR_SIZE, MAX_ITERATIONS );
+      const __m128i zero = _mm_setzero_si128();
+      __m128i lanes = zero;
+      for ( size_t j = 0; j < iterations; ++j, i += VECTOR_SIZE ) {
+        const __m128i words = _mm_loadu_si128( reinterpret_cast<const __m128i*>( data + i ) ); // NOLINT
+        lanes = _mm_add_epi32( lanes, _mm_unpacklo_epi16( words, zero ) );
+        lanes = _mm_add_epi32( lanes, _mm_unpackhi_epi16( words, zero ) );
+      }
+      std::array<uint32_t, VECTOR_SIZE / sizeof( uint32_t )> lane_sums {};
+      memcpy( lane_sums.data(), &lanes, sizeof( lanes ) );
+      for ( const uint32_t lane_sum : lane_sums ) {
+        sum += lane_sum;
       }
-      sum_ += val;
-      parity_ = !parity_;
     }
+#endif
+
+    // Eight bytes at a time: the two 32-bit halves of a word are each a pair of 16-bit words.
+    for ( ; len - i >= sizeof( uint64_t ); i += sizeof( uint64_t ) ) {
+      uint64_t word {};
+      memcpy( &word, data + i, sizeof( word ) );
+      sum += ( word >> 32 ) + ( word & 0xffffffff );
+    }
+
+    for ( ; i < len; i += sizeof( uint16_t ) ) {
+      uint16_t word {};
+      memcpy( &word, data + i, sizeof( word ) );
+      sum += word;
+    }
+
+    return sum;
   }
 
-  uint16_t value() const
+public:
+  explicit InternetChecksum( const uint32_t sum = 0 ) : sum_( sum ) {}
+  void add( std::string_view data )
   {
-    uint32_t ret = sum_;
+    if ( data.empty() ) {
+      return;
+    }
 
-    while ( ret > 0xffff ) {
-      ret = ( ret >> 16 ) + static_cast<uint16_t>( ret );
+    // Complete the 16-bit word left open by the previous chunk.
+    if ( parity_ ) {
+      sum_ += static_cast<uint8_t>( data.front() );
+      data.remove_prefix( 1 );
+      parity_ = false;
     }
 
-    return ~ret;
+    const size_t even_length = data.size() & ~size_t { 1 };
+    sum_ += to_network_order( fold( sum_native( data.data(), even_length ) ) );
+
+    if ( even_length < data.size() ) {
+      sum_ += static_cast<uint16_t>( static_cast<uint8_t>( data.back() ) << 8 );
+      parity_ = true;
+    }
   }
 
+  uint16_t value() const { return ~fold( sum_ ); }
+
   void add( const std::vector<Buffer>& data )
   {
     for ( const auto& x : data ) {
       add( x );
     }
   }
+
+  //! Update a checksum after one 16-bit word it covers changes from `old_word` to `new_word`,
+  //! without summing the rest of the data again (RFC 1624, eqn. 3: HC' = ~(~HC + ~m + m')).
+  static uint16_t update( const uint16_t checksum, const uint16_t old_word, const uint16_t new_word )
+  {
+    const uint32_t sum = static_cast<uint16_t>( ~checksum ) + static_cast<uint16_t>( ~old_word ) + new_word;
+    return ~fold( sum );
+  }
+
+  //! Update a checksum after a 32-bit field it covers (e.g. an address) changes.
+  static uint16_t update( const uint16_t checksum, const uint32_t old_field, const uint32_t new_field )
+  {
+    const uint16_t high
+      = update( checksum, static_cast<uint16_t>( old_field >> 16 ), static_cast<uint16_t>( new_field >> 16 ) );
+    return update( high, static_cast<uint16_t>( old_field ), static_cast<uint16_t>( new_field ) );
+  }
 };
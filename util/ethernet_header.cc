@@ -59,15 +59,9 @@ void EthernetHeader::parse( Parser& parser )
 
 void EthernetHeader::serialize( Serializer& serializer ) const
 {
-  // write destination address
-  for ( const auto& b : dst ) {
-    serializer.integer( b );
-  }
-
-  // write source address
-  for ( const auto& b : src ) {
-    serializer.integer( b );
-  }
+  // write destination and source addresses
+  serializer.string( bytes_of( dst ) );
+  serializer.string( bytes_of( src ) );
 
   // write frame type (e.g. IPv4, ARP, or something else)
   serializer.integer( type );
@@ -5,6 +5,7 @@
 #include <array>
 #include <cstdint>
 #include <string>
+#include <string_view>
 
 // Helper type for an Ethernet address (an array of six bytes)
 using EthernetAddress = std::array<uint8_t, 6>;
@@ -15,6 +16,12 @@ constexpr EthernetAddress ETHERNET_BROADCAST = { 0xff, 0xff, 0xff, 0xff, 0xff, 0
 // Printable representation of an EthernetAddress
 std::string to_string( EthernetAddress address );
 
+// The bytes of an EthernetAddress, as sent on the wire
+inline std::string_view bytes_of( const EthernetAddress& address )
+{
+  return { reinterpret_cast<const char*>( address.data() ), address.size() }; // NOLINT(*-reinterpret-cast)
+}
+
 // Ethernet frame header
 struct EthernetHeader
 {
@@ -22,6 +29,8 @@ struct EthernetHeader
   static constexpr uint16_t TYPE_IPv4 = 0x800; //!< Type number for [IPv4](\ref rfc::rfc791)
   static constexpr uint16_t TYPE_ARP = 0x806;  //!< Type number for [ARP](\ref rfc::rfc826)
 
+  static constexpr uint64_t serialized_length() { return LENGTH; }
+
   EthernetAddress dst;
   EthernetAddress src;
   uint16_t type;
@@ -155,6 +155,11 @@ size_t FileDescriptor::write( string_view buffer )
   return write( vector<string_view> { buffer } );
 }
 
+size_t FileDescriptor::write( const vector<Buffer>& buffers )
+{
+  return write( vector<string_view>( buffers.begin(), buffers.end() ) );
+}
+
 size_t FileDescriptor::write( const vector<string_view>& buffers )
 {
   vector<iovec> iovecs;
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "buffer.hh"
+
 #include <cstddef>
 #include <limits>
 #include <memory>
@@ -69,6 +71,7 @@ public:
   // returns number of bytes written
   size_t write( std::string_view buffer );
   size_t write( const std::vector<std::string_view>& buffers );
+  size_t write( const std::vector<Buffer>& buffers ); // e.g. the output of a Serializer
 
   // Close the underlying file descriptor
   void close() { internal_fd_->close(); }
@@ -3,7 +3,7 @@
 #include "ipv4_header.hh"
 #include "parser.hh"
 
-#include <memory>
+#include <array>
 #include <string>
 #include <vector>
 
@@ -21,6 +21,7 @@ struct IPv4Datagram
 
   void serialize( Serializer& serializer ) const
   {
+    serializer.reserve( header.serialized_length() );
     header.serialize( serializer );
     for ( const auto& x : payload ) {
       serializer.buffer( x );
@@ -29,3 +30,28 @@ struct IPv4Datagram
 };
 
 using InternetDatagram = IPv4Datagram;
+
+// Give each Buffer storage of its own (see Buffer::unshare())
+inline void unshare( std::vector<Buffer>& buffers )
+{
+  for ( auto& buffer : buffers ) {
+    buffer.unshare();
+  }
+}
+
+// Serialize a datagram that is no longer needed, reusing its payload. If the payload's first Buffer
+// has unshared headroom for the header (as one parsed from a contiguous frame does, where the old
+// header was), the header is written into it in place, and the result is just the payload.
+inline std::vector<Buffer> serialize( IPv4Datagram&& datagram )
+{
+  std::vector<Buffer> out = std::move( datagram.payload );
+  if ( not out.empty() and out.front().can_prepend( IPv4Header::LENGTH ) ) {
+    datagram.header.serialize( out.front().prepend( IPv4Header::LENGTH ).first<IPv4Header::LENGTH>() );
+    return out;
+  }
+
+  std::array<char, IPv4Header::LENGTH> header {};
+  datagram.header.serialize( header );
+  out.insert( out.begin(), Buffer::with_headroom( { header.data(), header.size() }, 0 ) );
+  return out;
+}
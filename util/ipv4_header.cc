@@ -3,11 +3,27 @@
 
 #include <arpa/inet.h>
 #include <array>
+#include <concepts>
 #include <cstddef>
 #include <sstream>
+#include <stdexcept>
 
 using namespace std;
 
+namespace {
+
+// Write `value` big-endian at `out`, and return the position just past it
+template<unsigned_integral T>
+char* put( char* out, const T value )
+{
+  for ( size_t i = 0; i < sizeof( T ); ++i ) {
+    *out++ = static_cast<char>( value >> ( ( sizeof( T ) - i - 1 ) * 8 ) );
+  }
+  return out;
+}
+
+} // namespace
+
 // Parse from string.
 void IPv4Header::parse( Parser& parser )
 {
@@ -51,28 +67,36 @@ void IPv4Header::parse( Parser& parser )
 
 // Serialize the IPv4Header (does not recompute the checksum)
 void IPv4Header::serialize( Serializer& serializer ) const
+{
+  array<char, LENGTH> bytes {};
+  serialize( bytes );
+  serializer.string( { bytes.data(), bytes.size() } );
+}
+
+void IPv4Header::serialize( const span<char, LENGTH> out ) const
 {
   // consistency checks
   if ( ver != 4 ) {
     throw runtime_error( "wrong IP version" );
   }
 
+  char* next = out.data();
   const uint8_t first_byte = ( static_cast<uint32_t>( ver ) << 4 ) | ( hlen & 0xfU );
-  serializer.integer( first_byte ); // version and header length
-  serializer.integer( tos );
-  serializer.integer( len );
-  serializer.integer( id );
+  next = put( next, first_byte ); // version and header length
+  next = put( next, tos );
+  next = put( next, len );
+  next = put( next, id );
 
   const uint16_t fo_val = ( df ? 0x4000U : 0 ) | ( mf ? 0x2000U : 0 ) | ( offset & 0x1fffU );
-  serializer.integer( fo_val );
+  next = put( next, fo_val );
 
-  serializer.integer( ttl );
-  serializer.integer( proto );
+  next = put( next, ttl );
+  next = put( next, proto );
 
-  serializer.integer( cksum );
+  next = put( next, cksum );
 
-  serializer.integer( src );
-  serializer.integer( dst );
+  next = put( next, src );
+  put( next, dst );
 }
 
 uint16_t IPv4Header::payload_length() const
@@ -103,15 +127,40 @@ uint32_t IPv4Header::pseudo_checksum() const
 void IPv4Header::compute_checksum()
 {
   cksum = 0;
-  Serializer s;
-  serialize( s );
+  array<char, LENGTH> bytes {};
+  serialize( bytes );
 
   // calculate checksum -- taken over header only
   InternetChecksum check;
-  check.add( s.output() );
+  check.add( string_view { bytes.data(), bytes.size() } );
   cksum = check.value();
 }
 
+void IPv4Header::decrement_ttl()
+{
+#ifdef CHECK_INCREMENTAL_CHECKSUMS
+  // The sanitized build cross-checks the patched checksum against a full recompute (when the original
+  // was correct). It costs two serializations, so other builds, which the benchmarks use, leave it out.
+  IPv4Header expected = *this;
+  expected.compute_checksum();
+  const bool was_correct = expected.cksum == cksum;
+#endif
+
+  // The TTL shares its 16-bit word of the header with the protocol number.
+  const uint16_t old_word = static_cast<uint16_t>( ttl << 8 | proto );
+  ttl -= 1;
+  const uint16_t new_word = static_cast<uint16_t>( ttl << 8 | proto );
+  cksum = InternetChecksum::update( cksum, old_word, new_word );
+
+#ifdef CHECK_INCREMENTAL_CHECKSUMS
+  expected.ttl = ttl;
+  expected.compute_checksum();
+  if ( was_correct and expected.cksum != cksum ) {
+    throw runtime_error( "IPv4Header::decrement_ttl: incremental checksum does not match full recompute" );
+  }
+#endif
+}
+
 std::string IPv4Header::to_string() const
 {
   stringstream ss {};
@@ -4,6 +4,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <span>
 #include <string>
 
 // IPv4 Internet datagram header (note: IP options are not supported)
@@ -57,9 +58,15 @@ struct IPv4Header
   // Set checksum to correct value
   void compute_checksum();
 
+  // Decrement the TTL and patch the checksum to match, without re-summing the header (RFC 1624)
+  void decrement_ttl();
+
   // Return a string containing a header in human-readable format
   std::string to_string() const;
 
   void parse( Parser& parser );
   void serialize( Serializer& serializer ) const;
+
+  // Write the header (as serialize() would) straight into `out`, e.g. into the headroom of a Buffer
+  void serialize( std::span<char, LENGTH> out ) const;
 };
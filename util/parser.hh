@@ -3,6 +3,7 @@
 #include "buffer.hh"
 
 #include <algorithm>
+#include <bit>
 #include <concepts>
 #include <cstdint>
 #include <cstring>
@@ -16,6 +17,22 @@
 
 class Serializer;
 
+// Convert an integer between native and network (big-endian) byte order
+template<std::unsigned_integral T>
+constexpr T network_order( const T value )
+{
+  if constexpr ( std::endian::native == std::endian::big or sizeof( T ) == 1 ) {
+    return value;
+  } else if constexpr ( sizeof( T ) == 2 ) {
+    return static_cast<T>( __builtin_bswap16( value ) );
+  } else if constexpr ( sizeof( T ) == 4 ) {
+    return static_cast<T>( __builtin_bswap32( value ) );
+  } else {
+    static_assert( sizeof( T ) == 8 );
+    return static_cast<T>( __builtin_bswap64( value ) );
+  }
+}
+
 class Parser
 {
   class BufferList
@@ -33,6 +50,14 @@ class Parser
       }
     }
 
+    // NOLINTNEXTLINE(*-explicit-*)
+    BufferList( std::vector<Buffer>&& buffers )
+    {
+      for ( auto& x : buffers ) {
+        append( std::move( x ) );
+      }
+    }
+
     uint64_t size() const { return size_; }
     uint64_t serialized_length() const { return size(); }
     bool empty() const { return size_ == 0; }
@@ -65,15 +90,16 @@ class Parser
       if ( empty() ) {
         return;
       }
-      std::string first_str = std::move( buffer_.front() );
-      if ( skip_ ) {
-        first_str = first_str.substr( skip_ );
-      }
-      out.emplace_back( std::move( first_str ) );
+      // The bytes already parsed off the first Buffer become its headroom, rather than being copied out.
+      out.push_back( std::move( buffer_.front() ) );
+      out.back().remove_prefix( skip_ );
       buffer_.pop_front();
+      skip_ = 0;
       for ( auto&& x : buffer_ ) {
         out.emplace_back( std::move( x ) );
       }
+      buffer_.clear();
+      size_ = 0;
     }
 
     void dump_all( Buffer& out )
@@ -81,7 +107,7 @@ class Parser
       std::vector<Buffer> concat;
       dump_all( concat );
       if ( concat.size() == 1 ) {
-        out = concat.front();
+        out = std::move( concat.front() );
         return;
       }
 
@@ -110,6 +136,7 @@ class Parser
 
 public:
   explicit Parser( const std::vector<Buffer>& input ) : input_( input ) {}
+  explicit Parser( std::vector<Buffer>&& input ) : input_( std::move( input ) ) {}
 
   const BufferList& input() const { return input_; }
 
@@ -125,17 +152,22 @@ public:
       return;
     }
 
-    if constexpr ( sizeof( T ) == 1 ) {
-      out = static_cast<uint8_t>( input_.peek().front() );
-      input_.remove_prefix( 1 );
+    // Usually the whole integer is in the current buffer, and can be loaded at once.
+    const std::string_view view = input_.peek();
+    if ( view.size() >= sizeof( T ) ) {
+      T value;
+      std::memcpy( &value, view.data(), sizeof( T ) );
+      out = network_order( value );
+      input_.remove_prefix( sizeof( T ) );
       return;
-    } else {
-      out = static_cast<T>( 0 );
-      for ( size_t i = 0; i < sizeof( T ); i++ ) {
-        out <<= 8;
-        out |= static_cast<uint8_t>( input_.peek().front() );
-        input_.remove_prefix( 1 );
-      }
+    }
+
+    // Otherwise it straddles a boundary between buffers.
+    out = static_cast<T>( 0 );
+    for ( size_t i = 0; i < sizeof( T ); i++ ) {
+      out <<= 8;
+      out |= static_cast<uint8_t>( input_.peek().front() );
+      input_.remove_prefix( 1 );
     }
   }
 
@@ -158,26 +190,41 @@ public:
   void all_remaining( Buffer& out ) { input_.dump_all( out ); }
 };
 
+// Writes an object's bytes into one contiguous Buffer, taking memory from Buffer's pool. Buffers that
+// the object already has (a payload, say) are passed along as they are rather than copied, so the
+// output is a list of Buffers, to be written out with a single writev(); an object without any is
+// output as a single Buffer.
 class Serializer
 {
   std::vector<Buffer> output_ {};
-  std::string buffer_ {};
+  Buffer buffer_ {}; // The bytes written since the last flush(), kept without headroom
+
+  std::string& bytes() { return buffer_; }
 
 public:
   Serializer() = default;
   explicit Serializer( std::string&& buffer ) : buffer_( std::move( buffer ) ) {}
 
+  // Make room for `n` more bytes (as given by the objects' serialized_length()), so that writing them
+  // allocates at most once
+  void reserve( size_t n )
+  {
+    if ( buffer_.empty() ) { // Without bytes(), which would take a node only to have it replaced
+      buffer_ = Buffer::with_headroom( {}, 0, n );
+    } else {
+      bytes().reserve( bytes().size() + n );
+    }
+  }
+
   template<std::unsigned_integral T>
   void integer( const T& val )
   {
-    constexpr uint64_t len = sizeof( T );
-
-    for ( uint64_t i = 0; i < len; ++i ) {
-      const uint8_t byte_val = val >> ( ( len - i - 1 ) * 8 );
-      buffer_.push_back( byte_val );
-    }
+    const T big_endian = network_order( val );
+    bytes().append( reinterpret_cast<const char*>( &big_endian ), sizeof( T ) ); // NOLINT(*-reinterpret-cast)
   }
 
+  void string( std::string_view str ) { bytes().append( str ); }
+
   void buffer( const Buffer& buf )
   {
     flush();
@@ -191,16 +238,19 @@ public:
     }
   }
 
+  // Finish the current Buffer, if anything has been written to it
   void flush()
   {
-    output_.emplace_back( std::move( buffer_ ) );
-    buffer_.clear();
+    if ( not buffer_.empty() ) {
+      output_.push_back( std::move( buffer_ ) ); // Leaves buffer_ empty, without a node
+    }
   }
 
+  // The Buffers written so far, which the Serializer gives up
   std::vector<Buffer> output()
   {
     flush();
-    return output_;
+    return std::move( output_ );
   }
 };
 
@@ -209,6 +259,9 @@ template<class T>
 std::vector<Buffer> serialize( const T& obj )
 {
   Serializer s;
+  if constexpr ( requires { obj.serialized_length(); } ) {
+    s.reserve( obj.serialized_length() );
+  }
   obj.serialize( s );
   return s.output();
 }
@@ -221,3 +274,12 @@ bool parse( T& obj, const std::vector<Buffer>& buffers )
   obj.parse( p );
   return not p.has_error();
 }
+
+// Same, taking over the buffers (so that what is parsed out of them need not share them)
+template<class T>
+bool parse( T& obj, std::vector<Buffer>&& buffers )
+{
+  Parser p { std::move( buffers ) };
+  obj.parse( p );
+  return not p.has_error();
+}